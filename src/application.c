@@ -172,6 +172,8 @@ app_pause(void *data)
     {
         playback_service_pause(app->p_ps);
     }
+    playback_service_save_state(app->p_ps);
+    playback_service_set_ui_visible(app->p_ps, false);
 
     intf_propagate_event(app->p_intf, INTERFACE_VIEW_EVENT_PAUSE);
 }
@@ -185,6 +187,7 @@ app_resume(void *data)
     playback_service *p_ps = application_get_playback_service(app);
 
     playback_service_set_auto_exit(p_ps, false);
+    playback_service_set_ui_visible(p_ps, true);
     intf_propagate_event(app->p_intf, INTERFACE_VIEW_EVENT_RESUME);
 }
 
@@ -26,6 +26,8 @@
 
 #include "common.h"
 
+#include <strings.h>
+
 #include "media_controller.h"
 #include "media_library_controller.h"
 #include "media_library_controller_private.h"
@@ -36,6 +38,11 @@
 #include "ui/views/video_view.h"
 #include "ui/views/audio_view.h"
 
+/* Number of items sent to the view at once when listing all the audio or video
+ * files. This roughly matches a screenful of rows, so the first one can be
+ * displayed before the rest of the library has been converted. */
+#define MEDIA_CONTROLLER_BATCH_SIZE 20
+
 static bool
 video_controller_accept_item( const library_item* p_item )
 {
@@ -76,16 +83,219 @@ playlist_controller_accept_item( const library_item* p_item )
     return p_item->i_library_item_type == LIBRARY_ITEM_PLAYLIST;
 }
 
+/*
+ * Lists are sorted by the media library, so the views can append the rows as they come.
+ * This only applies to the top level lists: views using their own content callback
+ * get the library order back (see media_library_controller_set_content_callback)
+ */
+static void
+media_controller_sort_by_title( media_library_controller* p_ctrl )
+{
+    media_library_controller_set_sort( p_ctrl, ML_SORT_TITLE );
+}
+
+/*
+ * Local counterparts of the media library orders, used to insert the items
+ * added while a list is displayed. Like the database, unset texts go first.
+ */
+static int
+media_controller_text_compare( const char* psz_a, const char* psz_b )
+{
+    if ( psz_a == NULL || psz_b == NULL )
+        return ( psz_a != NULL ) - ( psz_b != NULL );
+    return strcasecmp( psz_a, psz_b );
+}
+
+static int
+media_controller_number_compare( int64_t i_a, int64_t i_b )
+{
+    return ( i_a > i_b ) - ( i_a < i_b );
+}
+
+/* New items are the most recent ones, they go after the others */
+static int
+media_controller_insertion_compare( const void* p_a, const void* p_b )
+{
+    (void)p_a;
+    (void)p_b;
+    return 0;
+}
+
+static int
+media_controller_media_title_compare( const void* p_a, const void* p_b )
+{
+    const media_item* p_mi_a = p_a;
+    const media_item* p_mi_b = p_b;
+    return media_controller_text_compare( media_item_title( p_mi_a ),
+                                          media_item_title( p_mi_b ) );
+}
+
+static int
+media_controller_media_artist_compare( const void* p_a, const void* p_b )
+{
+    const media_item* p_mi_a = p_a;
+    const media_item* p_mi_b = p_b;
+    int i_res = media_controller_text_compare( media_item_artist( p_mi_a ),
+                                               media_item_artist( p_mi_b ) );
+    return i_res != 0 ? i_res : media_controller_media_title_compare( p_a, p_b );
+}
+
+static int
+media_controller_media_album_compare( const void* p_a, const void* p_b )
+{
+    const media_item* p_mi_a = p_a;
+    const media_item* p_mi_b = p_b;
+    int i_res = media_controller_text_compare( media_item_album( p_mi_a ),
+                                               media_item_album( p_mi_b ) );
+    return i_res != 0 ? i_res :
+            media_controller_number_compare( p_mi_a->i_track_number, p_mi_b->i_track_number );
+}
+
+static int
+media_controller_media_duration_compare( const void* p_a, const void* p_b )
+{
+    const media_item* p_mi_a = p_a;
+    const media_item* p_mi_b = p_b;
+    return media_controller_number_compare( p_mi_a->i_duration, p_mi_b->i_duration );
+}
+
+static int
+media_controller_media_track_number_compare( const void* p_a, const void* p_b )
+{
+    const media_item* p_mi_a = p_a;
+    const media_item* p_mi_b = p_b;
+    int i_res = media_controller_number_compare( p_mi_a->i_track_number, p_mi_b->i_track_number );
+    return i_res != 0 ? i_res : media_controller_media_title_compare( p_a, p_b );
+}
+
+static Eina_Compare_Cb
+media_controller_media_sort_compare( media_library_sort_key i_key )
+{
+    switch ( i_key )
+    {
+    case ML_SORT_TITLE:
+        return &media_controller_media_title_compare;
+    case ML_SORT_ARTIST:
+        return &media_controller_media_artist_compare;
+    case ML_SORT_ALBUM:
+        return &media_controller_media_album_compare;
+    case ML_SORT_DURATION:
+        return &media_controller_media_duration_compare;
+    case ML_SORT_INSERTION_DATE:
+        return &media_controller_insertion_compare;
+    case ML_SORT_TRACK_NUMBER:
+        return &media_controller_media_track_number_compare;
+    default:
+        return NULL;
+    }
+}
+
+static int
+media_controller_album_name_compare( const void* p_a, const void* p_b )
+{
+    return media_controller_text_compare( ((const album_item*)p_a)->psz_name,
+                                          ((const album_item*)p_b)->psz_name );
+}
+
+static int
+media_controller_album_duration_compare( const void* p_a, const void* p_b )
+{
+    return media_controller_number_compare( ((const album_item*)p_a)->i_duration,
+                                            ((const album_item*)p_b)->i_duration );
+}
+
+/* Albums don't hold their artist name, that order is left to the media library */
+static Eina_Compare_Cb
+media_controller_album_sort_compare( media_library_sort_key i_key )
+{
+    switch ( i_key )
+    {
+    case ML_SORT_TITLE:
+    case ML_SORT_ALBUM:
+        return &media_controller_album_name_compare;
+    case ML_SORT_DURATION:
+        return &media_controller_album_duration_compare;
+    case ML_SORT_INSERTION_DATE:
+        return &media_controller_insertion_compare;
+    default:
+        return NULL;
+    }
+}
+
+static int
+media_controller_artist_name_compare( const void* p_a, const void* p_b )
+{
+    return media_controller_text_compare( ((const artist_item*)p_a)->psz_name,
+                                          ((const artist_item*)p_b)->psz_name );
+}
+
+static Eina_Compare_Cb
+media_controller_artist_sort_compare( media_library_sort_key i_key )
+{
+    if ( i_key == ML_SORT_TITLE || i_key == ML_SORT_ARTIST )
+        return &media_controller_artist_name_compare;
+    return NULL;
+}
+
+static int
+media_controller_genre_name_compare( const void* p_a, const void* p_b )
+{
+    return media_controller_text_compare( ((const genre_item*)p_a)->psz_name,
+                                          ((const genre_item*)p_b)->psz_name );
+}
+
+static Eina_Compare_Cb
+media_controller_genre_sort_compare( media_library_sort_key i_key )
+{
+    if ( i_key == ML_SORT_TITLE )
+        return &media_controller_genre_name_compare;
+    return NULL;
+}
+
+static int
+media_controller_playlist_name_compare( const void* p_a, const void* p_b )
+{
+    return media_controller_text_compare( ((const playlist_item*)p_a)->psz_name,
+                                          ((const playlist_item*)p_b)->psz_name );
+}
+
+static Eina_Compare_Cb
+media_controller_playlist_sort_compare( media_library_sort_key i_key )
+{
+    if ( i_key == ML_SORT_TITLE )
+        return &media_controller_playlist_name_compare;
+    if ( i_key == ML_SORT_INSERTION_DATE )
+        return &media_controller_insertion_compare;
+    return NULL;
+}
+
+static void
+video_controller_get_content( media_library* p_ml, media_library_list_cb cb, void* p_user_data )
+{
+    media_library_get_video_files_streamed( p_ml, MEDIA_CONTROLLER_BATCH_SIZE, cb, p_user_data );
+}
+
+static void
+audio_controller_get_content( media_library* p_ml, media_library_list_cb cb, void* p_user_data )
+{
+    media_library_get_audio_files_streamed( p_ml, MEDIA_CONTROLLER_BATCH_SIZE, cb, p_user_data );
+}
+
 media_library_controller*
 video_controller_create(application* p_app, list_view* p_list_view)
 {
     media_library_controller* p_ctrl = media_library_controller_create( p_app, p_list_view );
     if ( p_ctrl == NULL )
         return NULL;
-    p_ctrl->pf_media_library_get_content = (pf_media_library_get_content_cb)&media_library_get_video_files;
-    p_ctrl->pf_item_duplicate = (pf_item_duplicate_cb)&media_item_copy;
+    p_ctrl->pf_media_library_get_content = &video_controller_get_content;
+    p_ctrl->b_streamed_content = true;
+    p_ctrl->pf_item_duplicate = (pf_item_duplicate_cb)&media_item_ref;
+    p_ctrl->pf_item_release = (pf_item_release_cb)&media_item_unref;
     p_ctrl->pf_item_compare = (pf_item_compare_cb)&media_item_identical;
+    p_ctrl->pf_item_equals = (pf_item_equals_cb)&media_item_equals;
     p_ctrl->pf_accept_item = &video_controller_accept_item;
+    p_ctrl->pf_sort_compare_get = &media_controller_media_sort_compare;
+    media_controller_sort_by_title( p_ctrl );
     return p_ctrl;
 }
 
@@ -95,10 +305,15 @@ audio_controller_create(application* p_app, list_view* p_list_view)
     media_library_controller* p_ctrl = media_library_controller_create( p_app, p_list_view );
     if ( p_ctrl == NULL )
         return NULL;
-    p_ctrl->pf_media_library_get_content = (pf_media_library_get_content_cb)&media_library_get_audio_files;
-    p_ctrl->pf_item_duplicate = (pf_item_duplicate_cb)&media_item_copy;
+    p_ctrl->pf_media_library_get_content = &audio_controller_get_content;
+    p_ctrl->b_streamed_content = true;
+    p_ctrl->pf_item_duplicate = (pf_item_duplicate_cb)&media_item_ref;
+    p_ctrl->pf_item_release = (pf_item_release_cb)&media_item_unref;
     p_ctrl->pf_item_compare = (pf_item_compare_cb)&media_item_identical;
+    p_ctrl->pf_item_equals = (pf_item_equals_cb)&media_item_equals;
     p_ctrl->pf_accept_item = &audio_controller_accept_item;
+    p_ctrl->pf_sort_compare_get = &media_controller_media_sort_compare;
+    media_controller_sort_by_title( p_ctrl );
     return p_ctrl;
 }
 
@@ -110,8 +325,12 @@ artist_controller_create(application* p_app, list_view* p_list_view)
         return NULL;
     p_ctrl->pf_media_library_get_content = (pf_media_library_get_content_cb)&media_library_get_artists;
     p_ctrl->pf_item_duplicate = (pf_item_duplicate_cb)&artist_item_copy;
+    p_ctrl->pf_item_release = (pf_item_release_cb)&artist_item_destroy;
     p_ctrl->pf_item_compare = (pf_item_compare_cb)&artist_item_identical;
+    p_ctrl->pf_item_equals = (pf_item_equals_cb)&artist_item_equals;
     p_ctrl->pf_accept_item = &artist_controller_accept_item;
+    p_ctrl->pf_sort_compare_get = &media_controller_artist_sort_compare;
+    media_controller_sort_by_title( p_ctrl );
     return p_ctrl;
 }
 
@@ -123,8 +342,12 @@ album_controller_create(application* p_app, list_view* p_list_view)
         return NULL;
     p_ctrl->pf_media_library_get_content = (pf_media_library_get_content_cb)&media_library_get_albums;
     p_ctrl->pf_item_duplicate = (pf_item_duplicate_cb)&album_item_copy;
+    p_ctrl->pf_item_release = (pf_item_release_cb)&album_item_destroy;
     p_ctrl->pf_item_compare = (pf_item_compare_cb)&album_item_identical;
+    p_ctrl->pf_item_equals = (pf_item_equals_cb)&album_item_equals;
     p_ctrl->pf_accept_item = &album_controller_accept_item;
+    p_ctrl->pf_sort_compare_get = &media_controller_album_sort_compare;
+    media_controller_sort_by_title( p_ctrl );
     return p_ctrl;
 }
 
@@ -136,8 +359,12 @@ genre_controller_create(application* p_app, list_view* p_list_view)
         return NULL;
     p_ctrl->pf_media_library_get_content = (pf_media_library_get_content_cb)&media_library_get_genres;
     p_ctrl->pf_item_duplicate = (pf_item_duplicate_cb)&genre_item_copy;
+    p_ctrl->pf_item_release = (pf_item_release_cb)&genre_item_destroy;
     p_ctrl->pf_item_compare = (pf_item_compare_cb)&genre_item_identical;
+    p_ctrl->pf_item_equals = (pf_item_equals_cb)&genre_item_equals;
     p_ctrl->pf_accept_item = &genre_controller_accept_item;
+    p_ctrl->pf_sort_compare_get = &media_controller_genre_sort_compare;
+    media_controller_sort_by_title( p_ctrl );
     return p_ctrl;
 }
 
@@ -149,7 +376,11 @@ playlist_controller_create(application* p_app, list_view* p_list_view)
         return NULL;
     p_ctrl->pf_media_library_get_content = (pf_media_library_get_content_cb)&media_library_get_playlists;
     p_ctrl->pf_item_duplicate = (pf_item_duplicate_cb)&playlist_item_copy;
+    p_ctrl->pf_item_release = (pf_item_release_cb)&playlist_item_destroy;
     p_ctrl->pf_item_compare = (pf_item_compare_cb)&playlist_item_identical;
+    p_ctrl->pf_item_equals = (pf_item_equals_cb)&playlist_item_equals;
     p_ctrl->pf_accept_item = &playlist_controller_accept_item;
+    p_ctrl->pf_sort_compare_get = &media_controller_playlist_sort_compare;
+    media_controller_sort_by_title( p_ctrl );
     return p_ctrl;
 }
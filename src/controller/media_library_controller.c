@@ -36,50 +36,245 @@
 
 #include "media_library_controller_private.h"
 
+/* Delay before sorting the items appended to a list that can't be sorted
+ * locally, so that a scan only triggers a query from time to time */
+#define MEDIA_LIBRARY_CONTROLLER_SORT_REFRESH_DELAY 2.0
+
+/*
+ * The index points to the list nodes, so that an item can be removed from the
+ * content without looking for it.
+ */
 static void
-media_library_controller_add_item(media_library_controller* ctrl, media_item* p_item)
+media_library_controller_index_node(media_library_controller* ctrl, Eina_List* p_node)
 {
-    void* p_view_item = ctrl->p_list_view->pf_append_item( ctrl->p_list_view->p_sys, p_item );
-    if (p_view_item == NULL)
-        return;
-    ctrl->p_content = eina_list_append(ctrl->p_content, p_view_item);
+    const library_item* p_library_item = ctrl->p_list_view->pf_get_item( eina_list_data_get(p_node) );
+    if (p_library_item->i_id != 0)
+        eina_hash_add(ctrl->p_content_index, &p_library_item->i_id, p_node);
+}
+
+/*
+ * Each controller only ever holds a single kind of library item (see pf_accept_item)
+ * so the media library ID is enough to identify an item.
+ * Items without an ID are not indexed, and have to be looked up the slow way.
+ */
+static Eina_List*
+media_library_controller_find_node(media_library_controller* ctrl, const library_item* p_library_item)
+{
+    if (p_library_item->i_id != 0)
+        return eina_hash_find(ctrl->p_content_index, &p_library_item->i_id);
+
+    Eina_List* it;
+    void* p_item;
+    EINA_LIST_FOREACH( ctrl->p_content, it, p_item )
+    {
+        const void* p_media_item = ctrl->p_list_view->pf_get_item(p_item);
+        if ( ctrl->pf_item_compare( p_media_item, p_library_item ) )
+            return it;
+    }
+    return NULL;
 }
 
-bool
-media_library_controller_file_update( media_library_controller* ctrl, const library_item* p_library_item )
+static void*
+media_library_controller_find_item(media_library_controller* ctrl, const library_item* p_library_item)
 {
-    if ( ctrl->pf_accept_item( p_library_item ) == false )
+    return eina_list_data_get( media_library_controller_find_node( ctrl, p_library_item ) );
+}
+
+/*
+ * While reconciling, every item that is part of the new content gets marked,
+ * so the unmarked ones can be removed once the whole content was received.
+ */
+static void
+media_library_controller_mark_seen(media_library_controller* ctrl, void* p_view_item)
+{
+    if (ctrl->p_reconcile_seen != NULL)
+        eina_hash_set(ctrl->p_reconcile_seen, &p_view_item, p_view_item);
+}
+
+/* Returns true if the view item already displays the exact same content */
+static bool
+media_library_controller_is_unchanged(media_library_controller* ctrl, void* p_view_item, const library_item* p_library_item)
+{
+    if (ctrl->pf_item_equals == NULL)
         return false;
+    return ctrl->pf_item_equals(ctrl->p_list_view->pf_get_item(p_view_item), p_library_item);
+}
 
-    void* p_new_library_item = ctrl->pf_item_duplicate( p_library_item );
-    if (p_new_library_item == NULL)
-        return true;
+/*
+ * Inserts a run of new items before p_before_node, or at the end of the
+ * content if it is NULL, through a single batch of the view.
+ * Returns the node of the last inserted row.
+ */
+static Eina_List*
+media_library_controller_insert_items(media_library_controller* ctrl, Eina_List* p_items, Eina_List* p_before_node)
+{
+    Eina_List* p_view_items = ctrl->p_list_view->pf_insert_items( ctrl->p_list_view->p_sys, p_items,
+            eina_list_data_get( p_before_node ) );
+    Eina_List* p_last = NULL;
+    list_view_item* p_view_item;
 
-    if ( ctrl->p_content != NULL )
+    eina_list_free( p_items );
+    EINA_LIST_FREE( p_view_items, p_view_item )
     {
-        Eina_List* it;
-        void* p_item;
-        EINA_LIST_FOREACH( ctrl->p_content, it, p_item )
+        if ( p_before_node == NULL )
         {
-            const void* p_media_item = ctrl->p_list_view->pf_get_item(p_item);
+            ctrl->p_content = eina_list_append( ctrl->p_content, p_view_item );
+            p_last = eina_list_last( ctrl->p_content );
+        }
+        else
+        {
+            ctrl->p_content = eina_list_prepend_relative_list( ctrl->p_content, p_view_item, p_before_node );
+            p_last = eina_list_prev( p_before_node );
+        }
+        media_library_controller_index_node( ctrl, p_last );
+        // Don't let the end of the reconciliation remove the rows it just added
+        media_library_controller_mark_seen( ctrl, p_view_item );
+    }
+    return p_last;
+}
+
+/*
+ * Inserts the items added to a sorted list at their position, in a single
+ * walk of the content once they are sorted.
+ * Items comparing equal to a row go after it.
+ */
+static void
+media_library_controller_insert_sorted(media_library_controller* ctrl, Eina_List* p_run, Eina_Compare_Cb pf_compare)
+{
+    Eina_List* p_node = ctrl->p_content;
+    Eina_List* p_batch = NULL;
+    library_item* p_item;
 
-            if ( ctrl->pf_item_compare( p_media_item, p_new_library_item) )
-            {
-                ctrl->p_list_view->pf_set_item(p_item, p_new_library_item);
-                return true;
-            }
+    p_run = eina_list_sort( p_run, 0, pf_compare );
+    EINA_LIST_FREE( p_run, p_item )
+    {
+        while ( p_node != NULL &&
+                pf_compare( ctrl->p_list_view->pf_get_item( eina_list_data_get( p_node ) ), p_item ) <= 0 )
+        {
+            if ( p_batch != NULL )
+                media_library_controller_insert_items( ctrl, p_batch, p_node );
+            p_batch = NULL;
+            p_node = eina_list_next( p_node );
         }
+        p_batch = eina_list_append( p_batch, p_item );
     }
-    media_library_controller_add_item( ctrl, p_new_library_item );
-    return true;
+    if ( p_batch != NULL )
+        media_library_controller_insert_items( ctrl, p_batch, p_node );
 }
 
-static bool
-media_library_controller_file_updated_cb(void* p_data, const library_item* p_new_media_item, bool b_added )
+static Eina_Bool
+media_library_controller_sort_refresh_cb(void* p_data)
 {
-    (void)b_added;
     media_library_controller* ctrl = (media_library_controller*)p_data;
-    return media_library_controller_file_update(ctrl, p_new_media_item);
+    ctrl->p_sort_refresh_timer = NULL;
+    media_library_controller_refresh(ctrl);
+    return ECORE_CALLBACK_CANCEL;
+}
+
+/*
+ * Inserts a run of new items.
+ * The content getter sends its items in their final order: while reconciling,
+ * new items go right after the last item received, instead of the end of the
+ * list. Live updates are inserted at their sorted position.
+ */
+static void
+media_library_controller_insert_run(media_library_controller* ctrl, Eina_List* p_run, bool b_ordered)
+{
+    if ( b_ordered == true && ctrl->p_reconcile_seen != NULL )
+    {
+        Eina_List* p_before_node = ctrl->p_reconcile_node != NULL ?
+                eina_list_next( ctrl->p_reconcile_node ) : ctrl->p_content;
+        Eina_List* p_last = media_library_controller_insert_items( ctrl, p_run, p_before_node );
+        if ( p_last != NULL )
+            ctrl->p_reconcile_node = p_last;
+        return;
+    }
+    if ( b_ordered == false && ctrl->i_sort_key != ML_SORT_DEFAULT )
+    {
+        Eina_Compare_Cb pf_compare = ctrl->pf_sort_compare_get != NULL ?
+                ctrl->pf_sort_compare_get( ctrl->i_sort_key ) : NULL;
+        if ( pf_compare != NULL )
+        {
+            media_library_controller_insert_sorted( ctrl, p_run, pf_compare );
+            return;
+        }
+        // The list will be queried again, once for all the items added meanwhile
+        if ( ctrl->p_sort_refresh_timer == NULL )
+            ctrl->p_sort_refresh_timer = ecore_timer_add( MEDIA_LIBRARY_CONTROLLER_SORT_REFRESH_DELAY,
+                                                          &media_library_controller_sort_refresh_cb, ctrl );
+    }
+    media_library_controller_insert_items( ctrl, p_run, NULL );
+}
+
+/*
+ * b_ordered is true when the items are part of the content delivered by the
+ * content getter, as opposed to live updates from the media library.
+ * The items we already know about are updated, the runs of new ones are
+ * inserted at once.
+ */
+static void
+media_library_controller_apply_items(media_library_controller* ctrl, Eina_List* p_content, bool b_ordered)
+{
+    bool b_reconcile = b_ordered == true && ctrl->p_reconcile_seen != NULL;
+    Eina_List* p_run = NULL;
+    Eina_List* it;
+    library_item* p_item;
+
+    EINA_LIST_FOREACH( p_content, it, p_item )
+    {
+        if ( ctrl->pf_accept_item( p_item ) == false )
+            continue;
+        Eina_List* p_node = media_library_controller_find_node( ctrl, p_item );
+        if ( p_node == NULL )
+        {
+            library_item* p_new_library_item = ctrl->pf_item_duplicate( p_item );
+            if ( p_new_library_item != NULL )
+                p_run = eina_list_append( p_run, p_new_library_item );
+            continue;
+        }
+        if ( b_reconcile == true )
+        {
+            // The run received so far goes before this item
+            if ( p_run != NULL )
+                media_library_controller_insert_run( ctrl, p_run, b_ordered );
+            p_run = NULL;
+            ctrl->p_reconcile_node = p_node;
+        }
+        void* p_view_item = eina_list_data_get( p_node );
+        media_library_controller_mark_seen( ctrl, p_view_item );
+        if ( media_library_controller_is_unchanged( ctrl, p_view_item, p_item ) )
+            continue;
+        library_item* p_new_library_item = ctrl->pf_item_duplicate( p_item );
+        if ( p_new_library_item != NULL )
+            ctrl->p_list_view->pf_set_item( p_view_item, p_new_library_item );
+    }
+    if ( p_run != NULL )
+        media_library_controller_insert_run( ctrl, p_run, b_ordered );
+}
+
+/*
+ * Removes the items that weren't part of the new content
+ */
+static void
+media_library_controller_end_reconcile(media_library_controller* ctrl)
+{
+    Eina_List* it;
+    Eina_List* it_next;
+    void* p_view_item;
+
+    EINA_LIST_FOREACH_SAFE( ctrl->p_content, it, it_next, p_view_item )
+    {
+        if ( eina_hash_find( ctrl->p_reconcile_seen, &p_view_item ) != NULL )
+            continue;
+        const library_item* p_library_item = ctrl->p_list_view->pf_get_item( p_view_item );
+        if ( p_library_item->i_id != 0 )
+            eina_hash_del_by_key( ctrl->p_content_index, &p_library_item->i_id );
+        ctrl->p_content = eina_list_remove_list( ctrl->p_content, it );
+        ctrl->p_list_view->pf_remove_item( ctrl->p_list_view->p_sys, p_view_item );
+    }
+    eina_hash_free( ctrl->p_reconcile_seen );
+    ctrl->p_reconcile_seen = NULL;
+    ctrl->p_reconcile_node = NULL;
 }
 
 /* Called by the Media Library with updated video list
@@ -88,15 +283,57 @@ media_library_controller_file_updated_cb(void* p_data, const library_item* p_new
 void
 media_library_controller_content_update_cb(Eina_List* p_content, void* p_data)
 {
-    if (p_content == NULL)
-        return;
     media_library_controller* ctrl = (media_library_controller*)p_data;
-    Eina_List* it;
     void* p_item;
 
-    EINA_LIST_FOREACH( p_content, it, p_item )
+    bool b_end = p_content == NULL || ctrl->b_streamed_content == false;
+
+    media_library_controller_apply_items( ctrl, p_content, true );
+    // The view only keeps its own references to the items
+    EINA_LIST_FREE( p_content, p_item )
+        ctrl->pf_item_release( p_item );
+    // Streamed content ends with a NULL list, the other getters send it all at once
+    if ( ctrl->p_reconcile_seen != NULL && b_end )
+        media_library_controller_end_reconcile( ctrl );
+}
+
+static void
+media_library_controller_files_updated_cb(void* p_data, Eina_List* p_items, bool b_added )
+{
+    media_library_controller* ctrl = (media_library_controller*)p_data;
+    (void)b_added;
+    media_library_controller_apply_items(ctrl, p_items, false);
+}
+
+/*
+ * Called by the Media Library with a batch of deleted items IDs
+ * Guaranteed to be called from the main loop
+ */
+static void
+media_library_controller_items_deleted_cb(void* p_data, library_item_type i_type, const int64_t* pi_ids, unsigned int i_nb_ids)
+{
+    media_library_controller* ctrl = (media_library_controller*)p_data;
+    if (ctrl->p_list_view->pf_remove_item == NULL)
     {
-        media_library_controller_file_update(ctrl, p_item);
+        // The view can't drop single rows, fall back to a full refresh
+        media_library_controller_refresh(ctrl);
+        return;
+    }
+    for (unsigned int i = 0; i < i_nb_ids; ++i)
+    {
+        Eina_List* p_node = eina_hash_find(ctrl->p_content_index, &pi_ids[i]);
+        if (p_node == NULL)
+            continue;
+        list_view_item* p_view_item = eina_list_data_get(p_node);
+        // IDs are only unique for a given item type
+        const library_item* p_library_item = ctrl->p_list_view->pf_get_item(p_view_item);
+        if (p_library_item->i_library_item_type != i_type)
+            continue;
+        eina_hash_del_by_key(ctrl->p_content_index, &pi_ids[i]);
+        if (ctrl->p_reconcile_node == p_node)
+            ctrl->p_reconcile_node = eina_list_prev(p_node);
+        ctrl->p_content = eina_list_remove_list(ctrl->p_content, p_node);
+        ctrl->p_list_view->pf_remove_item(ctrl->p_list_view->p_sys, p_view_item);
     }
 }
 
@@ -108,22 +345,49 @@ void
 media_library_controller_content_changed_cb(void* p_data)
 {
     media_library_controller* ctrl = (media_library_controller*)p_data;
+    media_library* p_ml = (media_library*)application_get_media_library( ctrl->p_app );
 
-    // Discard previous content if any, and ask ML for the new content
-    if (ctrl->p_content != NULL)
+    // Results of a previous request are about to be superseded
+    media_library_cancel_queries(p_ml, ctrl);
+    if (ctrl->p_reconcile_seen != NULL)
+    {
+        eina_hash_free(ctrl->p_reconcile_seen);
+        ctrl->p_reconcile_seen = NULL;
+    }
+    ctrl->p_reconcile_node = NULL;
+
+    /*
+     * If we already have some content, only apply the difference with the
+     * new one, so the unchanged rows (and the scroll position) are kept.
+     * Otherwise, or if the view can't remove single rows, start from scratch.
+     */
+    if (ctrl->p_content != NULL && ctrl->p_list_view->pf_remove_item != NULL)
+        ctrl->p_reconcile_seen = eina_hash_pointer_new(NULL);
+    if (ctrl->p_content != NULL && ctrl->p_reconcile_seen == NULL)
     {
         eina_list_free(ctrl->p_content);
+        eina_hash_free_buckets(ctrl->p_content_index);
         ctrl->p_list_view->pf_clear(ctrl->p_list_view->p_sys);
         ctrl->p_content = NULL;
     }
-    media_library* p_ml = (media_library*)application_get_media_library( ctrl->p_app );
     ctrl->pf_media_library_get_content(p_ml, &media_library_controller_content_update_cb, ctrl->p_user_data);
 }
 
+static void
+media_library_controller_refresh_job_cb(void* p_data)
+{
+    media_library_controller* ctrl = (media_library_controller*)p_data;
+    ctrl->p_refresh_job = NULL;
+    media_library_controller_content_changed_cb(ctrl);
+}
+
 void
 media_library_controller_refresh(media_library_controller* p_ctrl)
 {
-    ecore_main_loop_thread_safe_call_async(&media_library_controller_content_changed_cb, p_ctrl);
+    // Multiple refresh requests before the job runs only trigger one query
+    if (p_ctrl->p_refresh_job != NULL)
+        return;
+    p_ctrl->p_refresh_job = ecore_job_add(&media_library_controller_refresh_job_cb, p_ctrl);
 }
 
 void
@@ -131,6 +395,25 @@ media_library_controller_set_content_callback(media_library_controller* p_ctrl,
 {
     p_ctrl->pf_media_library_get_content = cb;
     p_ctrl->p_user_data = p_user_data;
+    // Custom content callbacks deliver their content all at once
+    p_ctrl->b_streamed_content = false;
+    // Drill-down lists have their own natural order (track number, playlist order...)
+    media_library_controller_set_sort(p_ctrl, ML_SORT_DEFAULT);
+}
+
+void
+media_library_controller_set_sort(media_library_controller* p_ctrl, media_library_sort_key i_key)
+{
+    media_library* p_ml = (media_library*)application_get_media_library(p_ctrl->p_app);
+    p_ctrl->i_sort_key = i_key;
+    media_library_set_sort(p_ml, p_ctrl, i_key, false, NULL);
+}
+
+void
+media_library_controller_set_visible(media_library_controller* p_ctrl, bool b_visible)
+{
+    media_library* p_ml = (media_library*)application_get_media_library(p_ctrl->p_app);
+    media_library_set_query_priority(p_ml, p_ctrl, b_visible ? ML_QUERY_PRIORITY_VISIBLE : ML_QUERY_PRIORITY_PREFETCH);
 }
 
 media_library_controller*
@@ -141,13 +424,20 @@ media_library_controller_create(application* p_app, list_view* p_list_view )
        return NULL;
    ctrl->p_app = p_app;
    ctrl->p_list_view = p_list_view;
+   ctrl->p_content_index = eina_hash_int64_new(NULL);
+   if ( ctrl->p_content_index == NULL )
+   {
+       free(ctrl);
+       return NULL;
+   }
    /* Default the user data to ourselves. This is when the callbacks are our defaults ones */
    ctrl->p_user_data = ctrl;
 
    /* Populate it */
    media_library* p_ml = (media_library*)application_get_media_library(p_app);
    media_library_register_on_change(p_ml, media_library_controller_content_changed_cb, ctrl);
-   media_library_register_item_updated(p_ml, media_library_controller_file_updated_cb, ctrl);
+   media_library_register_items_updated(p_ml, media_library_controller_files_updated_cb, ctrl);
+   media_library_register_items_deleted(p_ml, media_library_controller_items_deleted_cb, ctrl);
    return ctrl;
 }
 
@@ -155,8 +445,20 @@ void
 media_library_controller_destroy(media_library_controller *ctrl)
 {
     eina_list_free(ctrl->p_content);
+    eina_hash_free(ctrl->p_content_index);
+    if (ctrl->p_reconcile_seen != NULL)
+        eina_hash_free(ctrl->p_reconcile_seen);
+    if (ctrl->p_refresh_job != NULL)
+        ecore_job_del(ctrl->p_refresh_job);
+    if (ctrl->p_sort_refresh_timer != NULL)
+        ecore_timer_del(ctrl->p_sort_refresh_timer);
     media_library* p_ml = (media_library*)application_get_media_library(ctrl->p_app);
+    // Don't let pending queries call us back once we're gone
+    media_library_set_query_priority(p_ml, ctrl, ML_QUERY_PRIORITY_VISIBLE);
+    media_library_cancel_queries(p_ml, ctrl);
+    media_library_set_sort(p_ml, ctrl, ML_SORT_DEFAULT, false, NULL);
     media_library_unregister_on_change(p_ml, &media_library_controller_content_changed_cb, ctrl);
-    media_library_unregister_item_updated(p_ml, &media_library_controller_file_updated_cb, ctrl);
+    media_library_unregister_items_updated(p_ml, &media_library_controller_files_updated_cb, ctrl);
+    media_library_unregister_items_deleted(p_ml, &media_library_controller_items_deleted_cb, ctrl);
     free(ctrl);
 }
@@ -29,6 +29,7 @@
 
 #include "application.h"
 #include "ui/interface.h"
+#include "media/library/media_library.hpp"
 
 media_library_controller*
 media_library_controller_create( application* p_app, list_view* p_list_view );
@@ -39,7 +40,26 @@ media_library_controller_destroy(media_library_controller *);
 void
 media_library_controller_refresh( media_library_controller* p_ctrl );
 
+/*
+ * Replaces the content getter. The content it delivers is kept in the order
+ * the media library returns it, until media_library_controller_set_sort is
+ * called again.
+ */
 void
 media_library_controller_set_content_callback(media_library_controller* p_ctrl, void(*cb)(media_library* p_ml, media_library_list_cb cb, void* p_user_data), void* p_user_data);
 
+/*
+ * Sets the order of the content. The getters must be issued with the
+ * controller as their user data for the order to apply.
+ */
+void
+media_library_controller_set_sort(media_library_controller* p_ctrl, media_library_sort_key i_key);
+
+/*
+ * Hidden lists (ie. below a drill-down view) have their queries run after
+ * the ones of the visible lists.
+ */
+void
+media_library_controller_set_visible(media_library_controller* p_ctrl, bool b_visible);
+
 #endif /* MEDIA_LIBRARY_CONTROLLER_H_ */
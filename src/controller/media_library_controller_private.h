@@ -29,6 +29,8 @@
 
 #include "application.h"
 #include "media/library/library_item.h"
+#include "media/library/media_library.hpp"
+#include "ui/interface.h"
 
 struct library_item
 {
@@ -37,8 +39,11 @@ struct library_item
 
 typedef void                (*pf_media_library_get_content_cb)( media_library* p_ml, media_library_list_cb cb, void* p_user_data );
 typedef bool                (*pf_item_compare_cb)(const void* p_left, const void* p_right);
+typedef bool                (*pf_item_equals_cb)(const void* p_left, const void* p_right);
 typedef void*               (*pf_item_duplicate_cb)( const void* p_item );
+typedef void                (*pf_item_release_cb)( void* p_item );
 typedef bool                (*pf_accept_item_cb)( const library_item* p_item );
+typedef Eina_Compare_Cb     (*pf_sort_compare_get_cb)( media_library_sort_key i_key );
 
 struct media_library_controller
 {
@@ -48,15 +53,27 @@ struct media_library_controller
     application*    p_app;
     list_view*      p_list_view;
     Eina_List*      p_content;
+    Eina_Hash*      p_content_index;    /* library item ID -> node of p_content */
     void*           p_user_data;
+    Ecore_Job*      p_refresh_job;
+    Ecore_Timer*    p_sort_refresh_timer;   /* re-sorts the items appended to a sorted list */
+    Eina_Hash*      p_reconcile_seen;   /* list_view_item set, non NULL while reconciling */
+    Eina_List*      p_reconcile_node;   /* node of the last item of the new content received while reconciling */
+    media_library_sort_key  i_sort_key; /* ML_SORT_DEFAULT when the content is in the library order */
+    bool            b_streamed_content; /* content is received in batches, ended by a NULL list */
 
     /**
      * Callbacks & settings
      */
     pf_media_library_get_content_cb pf_media_library_get_content;
     pf_item_compare_cb              pf_item_compare;
+    pf_item_equals_cb               pf_item_equals;     /* optional, avoids no-op updates */
     pf_item_duplicate_cb            pf_item_duplicate;
+    pf_item_release_cb              pf_item_release;    /* releases the items received from the media library */
     pf_accept_item_cb               pf_accept_item;
+    /* optional, compares two items in the order of the given sort key, or
+     * returns NULL if the items don't hold what the key sorts on */
+    pf_sort_compare_get_cb          pf_sort_compare_get;
 };
 
 #endif //MEDIA_LIBRARY_CONTROLLER_PRIVATE_H_
@@ -55,6 +55,7 @@ album_item_copy(const album_item* p_item)
     if (p_item->psz_artwork != NULL)
         p_new_item->psz_artwork = strdup(p_item->psz_artwork);
     p_new_item->i_nb_tracks = p_item->i_nb_tracks;
+    p_new_item->i_duration = p_item->i_duration;
     p_new_item->i_release_date = p_item->i_release_date;
     return p_new_item;
 }
@@ -65,6 +66,18 @@ album_item_identical(const album_item* p_left, const album_item* p_right)
     return p_left->i_id == p_right->i_id;
 }
 
+bool
+album_item_equals(const album_item* p_left, const album_item* p_right)
+{
+    return p_left->i_id == p_right->i_id &&
+            p_left->i_release_date == p_right->i_release_date &&
+            p_left->i_nb_tracks == p_right->i_nb_tracks &&
+            p_left->i_duration == p_right->i_duration &&
+            library_item_str_equals(p_left->psz_name, p_right->psz_name) &&
+            library_item_str_equals(p_left->psz_summary, p_right->psz_summary) &&
+            library_item_str_equals(p_left->psz_artwork, p_right->psz_artwork);
+}
+
 void
 album_item_destroy(album_item* p_item)
 {
@@ -36,12 +36,12 @@ extern "C" {
 typedef struct album_item {
     LIBRARY_ITEM_COMMON
 
-    int64_t i_id;
     char* psz_name;
     char* psz_summary;
     time_t i_release_date;
     char* psz_artwork;
     uint32_t i_nb_tracks;
+    int64_t i_duration;     /* in ms */
 } album_item;
 
 album_item*
@@ -53,6 +53,10 @@ album_item_copy(const album_item* p_item);
 bool
 album_item_identical(const album_item* p_left, const album_item* p_right);
 
+/* Returns true if both items hold the exact same content */
+bool
+album_item_equals(const album_item* p_left, const album_item* p_right);
+
 void
 album_item_destroy(album_item* p_item);
 
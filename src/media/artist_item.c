@@ -68,6 +68,8 @@ artist_item_copy(const artist_item* p_item )
     if (p_item->psz_artwork != NULL)
         p_new->psz_artwork = strdup(p_item->psz_artwork);
     p_new->i_nb_albums = p_item->i_nb_albums;
+    p_new->i_nb_tracks = p_item->i_nb_tracks;
+    p_new->i_duration = p_item->i_duration;
     return p_new;
 }
 
@@ -77,6 +79,17 @@ artist_item_identical(const artist_item* p_left, const artist_item* p_right)
     return p_left->i_id == p_right->i_id;
 }
 
+bool
+artist_item_equals(const artist_item* p_left, const artist_item* p_right)
+{
+    return p_left->i_id == p_right->i_id &&
+            p_left->i_nb_albums == p_right->i_nb_albums &&
+            p_left->i_nb_tracks == p_right->i_nb_tracks &&
+            p_left->i_duration == p_right->i_duration &&
+            library_item_str_equals(p_left->psz_name, p_right->psz_name) &&
+            library_item_str_equals(p_left->psz_artwork, p_right->psz_artwork);
+}
+
 const char*
 artist_item_get_name(const artist_item* p_item)
 {
@@ -40,7 +40,8 @@ typedef struct artist_item
     char* psz_name;
     char* psz_artwork;
     uint32_t i_nb_albums;
-    int64_t i_id;
+    uint32_t i_nb_tracks;
+    int64_t i_duration;     /* in ms */
 } artist_item;
 
 artist_item*
@@ -55,6 +56,10 @@ artist_item_copy(const artist_item* p_item );
 bool
 artist_item_identical(const artist_item* p_left, const artist_item* p_right);
 
+/* Returns true if both items hold the exact same content */
+bool
+artist_item_equals(const artist_item* p_left, const artist_item* p_right);
+
 const char*
 artist_item_get_name(const artist_item* p_item);
 
@@ -50,6 +50,9 @@ genre_item_copy(const genre_item* p_item)
     if (p_new_item == NULL)
         return NULL;
     p_new_item->i_id = p_item->i_id;
+    p_new_item->i_nb_albums = p_item->i_nb_albums;
+    p_new_item->i_nb_tracks = p_item->i_nb_tracks;
+    p_new_item->i_duration = p_item->i_duration;
     return p_new_item;
 }
 
@@ -59,6 +62,16 @@ genre_item_identical(const genre_item* p_left, const genre_item* p_right)
     return p_left->i_id == p_right->i_id;
 }
 
+bool
+genre_item_equals(const genre_item* p_left, const genre_item* p_right)
+{
+    return p_left->i_id == p_right->i_id &&
+            p_left->i_nb_albums == p_right->i_nb_albums &&
+            p_left->i_nb_tracks == p_right->i_nb_tracks &&
+            p_left->i_duration == p_right->i_duration &&
+            library_item_str_equals(p_left->psz_name, p_right->psz_name);
+}
+
 
 void
 genre_item_destroy(genre_item* p_item)
@@ -36,8 +36,10 @@ extern "C" {
 typedef struct genre_item {
     LIBRARY_ITEM_COMMON
 
-    int64_t i_id;
     char* psz_name;
+    uint32_t i_nb_albums;
+    uint32_t i_nb_tracks;
+    int64_t i_duration;     /* in ms */
 } genre_item;
 
 genre_item*
@@ -49,6 +51,10 @@ genre_item_copy( const genre_item* p_item );
 bool
 genre_item_identical( const genre_item* p_left, const genre_item* p_right);
 
+/* Returns true if both items hold the exact same content */
+bool
+genre_item_equals( const genre_item* p_left, const genre_item* p_right );
+
 void
 genre_item_destroy( genre_item* p_item );
 
@@ -28,6 +28,8 @@
 
 #include <ctime>
 
+#include <sqlite3.h>
+
 #include "media_library_private.hpp"
 #include "IVideoTrack.h"
 #include "IAlbum.h"
@@ -67,8 +69,12 @@ path_from_url(const char* psz_str)
 }
 
 
-media_item*
-fileToMediaItem( MediaPtr media )
+/*
+ * Builds a media_item from the media itself, and the data related to it which
+ * had to be fetched separately (either lazily, or in bulk)
+ */
+static media_item*
+mediaDataToMediaItem( MediaPtr media, const MediaConvertor::MediaData& data )
 {
     auto type = MEDIA_ITEM_TYPE_UNKNOWN;
     switch ( media->type() )
@@ -83,21 +89,14 @@ fileToMediaItem( MediaPtr media )
         LOGW( "Unknown file type: %d", media->type() );
         return nullptr;
     }
-    auto files = media->files();
-    if ( files.size() == 0 )
-    {
-        LOGE("Can't add a media with no files representation");
-        return NULL;
-    }
-    const auto& file = files[0];
 
-    auto mi = media_item_create( file->mrl().c_str(), type );
+    auto mi = media_item_create( data.mrl.c_str(), type );
     if ( mi == nullptr )
     {
         //FIXME: What should we do? This won't be run again until the next time
         //we restore the media library. Also, do we care? This is likely E_NOMEM, so we
         //might have bigger problems than a missing file...
-        LOGE( "Failed to create media_item for media %s", file->mrl().c_str() );
+        LOGE( "Failed to create media_item for media %s", data.mrl.c_str() );
         return nullptr;
     }
     mi->i_id = media->id();
@@ -106,27 +105,21 @@ fileToMediaItem( MediaPtr media )
     mi->i_duration = media->duration();
     if ( media->type() == IMedia::Type::VideoType )
     {
-        auto vtracks = media->videoTracks();
-        if ( vtracks.size() != 0 )
+        if ( data.hasVideoTrack == true )
         {
-            if ( vtracks.size() > 1 )
-                LOGW( "Ignoring file [%s] extra video tracks for media description", file->mrl().c_str() );
-            auto vtrack = vtracks[0];
-            mi->i_w = vtrack->width();
-            mi->i_h = vtrack->height();
+            mi->i_w = data.width;
+            mi->i_h = data.height;
         }
         if (media->thumbnail().length() > 0)
-            mi->psz_snapshot = strdup(media->thumbnail().c_str());
+            media_item_set_snapshot(mi, media->thumbnail().c_str());
     }
     else if ( media->type() == IMedia::Type::AudioType )
     {
-        auto albumTrack = media->albumTrack();
-        if (albumTrack != nullptr)
+        if ( data.hasAlbumTrack == true )
         {
-            auto album = albumTrack->album();
-            if (album != nullptr)
+            if ( data.hasAlbum == true )
             {
-                media_item_set_meta(mi, MEDIA_ITEM_META_ALBUM, album->title().c_str());
+                media_item_set_meta(mi, MEDIA_ITEM_META_ALBUM, data.albumTitle.c_str());
                 auto year = media->releaseDate();
                 if (year != 0)
                 {
@@ -134,20 +127,227 @@ fileToMediaItem( MediaPtr media )
                 }
                 auto artwork = media->thumbnail();
                 if ( artwork.empty() == true )
-                    artwork = album->artworkMrl();
-                mi->psz_snapshot = path_from_url(artwork.c_str());
+                    artwork = data.albumArtwork;
+                char* psz_artwork = path_from_url(artwork.c_str());
+                media_item_set_snapshot(mi, psz_artwork);
+                free(psz_artwork);
+            }
+            mi->i_track_number = data.trackNumber;
+            if ( data.hasArtist == true )
+                media_item_set_meta(mi, MEDIA_ITEM_META_ARTIST, data.artistName.c_str());
+        }
+    }
+    return mi;
+}
+
+/*
+ * Slow path: each related entity is lazily fetched by the medialibrary,
+ * which costs a database round-trip for each of them.
+ */
+media_item*
+fileToMediaItem( MediaPtr media )
+{
+    auto type = media->type();
+    if ( type != IMedia::Type::VideoType && type != IMedia::Type::AudioType )
+    {
+        LOGW( "Unknown file type: %d", type );
+        return nullptr;
+    }
+    auto files = media->files();
+    if ( files.size() == 0 )
+    {
+        LOGE("Can't add a media with no files representation");
+        return NULL;
+    }
+    MediaConvertor::MediaData data;
+    data.mrl = files[0]->mrl();
+
+    if ( type == IMedia::Type::VideoType )
+    {
+        auto vtracks = media->videoTracks();
+        if ( vtracks.size() != 0 )
+        {
+            if ( vtracks.size() > 1 )
+                LOGW( "Ignoring file [%s] extra video tracks for media description", data.mrl.c_str() );
+            auto vtrack = vtracks[0];
+            data.hasVideoTrack = true;
+            data.width = vtrack->width();
+            data.height = vtrack->height();
+        }
+    }
+    else
+    {
+        auto albumTrack = media->albumTrack();
+        if (albumTrack != nullptr)
+        {
+            data.hasAlbumTrack = true;
+            data.trackNumber = albumTrack->trackNumber();
+            auto album = albumTrack->album();
+            if (album != nullptr)
+            {
+                data.hasAlbum = true;
+                data.albumTitle = album->title();
+                data.albumArtwork = album->artworkMrl();
             }
-            mi->i_track_number = albumTrack->trackNumber();
             auto artist = albumTrack->artist();
             if (artist != nullptr)
-                media_item_set_meta(mi, MEDIA_ITEM_META_ARTIST, artist->name().c_str());
+            {
+                data.hasArtist = true;
+                data.artistName = artist->name();
+            }
         }
     }
-    return mi;
+    return mediaDataToMediaItem( media, data );
+}
+
+/*
+ * Bulk path: the files, album tracks, albums, artists and video tracks of a
+ * whole window of media are fetched with a few set based queries on the
+ * medialibrary database, instead of ~6 lazy queries per media.
+ */
+MediaConvertor::MediaConvertor( const std::string& dbPath )
+    : m_dbPath( dbPath )
+{
+}
+
+bool
+MediaConvertor::open()
+{
+    if ( m_db != nullptr )
+        return true;
+    if ( m_dbPath.empty() == true )
+        return false;
+    sqlite3* db;
+    if ( sqlite3_open_v2( m_dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr ) != SQLITE_OK )
+    {
+        LOGE( "Failed to open %s: %s", m_dbPath.c_str(), sqlite3_errmsg( db ) );
+        sqlite3_close( db );
+        // Don't try again for each window
+        m_dbPath.clear();
+        return false;
+    }
+    // The medialibrary may be writing at the same time
+    sqlite3_busy_timeout( db, 500 );
+    m_db.reset( db, &sqlite3_close );
+    return true;
+}
+
+bool
+MediaConvertor::run( const std::string& req, std::function<void(sqlite3_stmt*)> rowCb )
+{
+    sqlite3_stmt* stmt;
+    if ( sqlite3_prepare_v2( m_db.get(), req.c_str(), -1, &stmt, nullptr ) != SQLITE_OK )
+    {
+        LOGE( "Failed to prepare bulk conversion request: %s", sqlite3_errmsg( m_db.get() ) );
+        return false;
+    }
+    int rc;
+    while ( ( rc = sqlite3_step( stmt ) ) == SQLITE_ROW )
+        rowCb( stmt );
+    sqlite3_finalize( stmt );
+    if ( rc != SQLITE_DONE )
+    {
+        LOGE( "Failed to run bulk conversion request: %s", sqlite3_errmsg( m_db.get() ) );
+        return false;
+    }
+    return true;
+}
+
+static std::string
+columnText( sqlite3_stmt* stmt, int col )
+{
+    auto str = reinterpret_cast<const char*>( sqlite3_column_text( stmt, col ) );
+    return str != nullptr ? str : "";
+}
+
+void
+MediaConvertor::prepare( const std::vector<MediaPtr>& media, size_t first, size_t last )
+{
+    m_data.clear();
+    if ( first >= last || open() == false )
+        return;
+
+    std::string audioIds, videoIds;
+    for ( auto i = first; i < last; ++i )
+    {
+        auto& ids = media[i]->type() == IMedia::Type::AudioType ? audioIds : videoIds;
+        if ( ids.empty() == false )
+            ids += ',';
+        ids += std::to_string( media[i]->id() );
+    }
+    std::string allIds = audioIds;
+    if ( allIds.empty() == false && videoIds.empty() == false )
+        allIds += ',';
+    allIds += videoIds;
+
+    // Only keep the first file, as the slow path does
+    auto res = run( "SELECT media_id, mrl FROM File WHERE media_id IN (" + allIds + ") ORDER BY id_file",
+            [this]( sqlite3_stmt* stmt ) {
+        auto& data = m_data[sqlite3_column_int64( stmt, 0 )];
+        if ( data.mrl.empty() == true )
+            data.mrl = columnText( stmt, 1 );
+    });
+    if ( res == true && audioIds.empty() == false )
+    {
+        res = run( "SELECT t.media_id, t.track_number, alb.id_album, alb.title, alb.artwork_mrl,"
+                   " art.id_artist, art.name FROM AlbumTrack t"
+                   " LEFT JOIN Album alb ON alb.id_album = t.album_id"
+                   " LEFT JOIN Artist art ON art.id_artist = t.artist_id"
+                   " WHERE t.media_id IN (" + audioIds + ")",
+                [this]( sqlite3_stmt* stmt ) {
+            auto& data = m_data[sqlite3_column_int64( stmt, 0 )];
+            data.hasAlbumTrack = true;
+            data.trackNumber = sqlite3_column_int( stmt, 1 );
+            if ( sqlite3_column_type( stmt, 2 ) != SQLITE_NULL )
+            {
+                data.hasAlbum = true;
+                data.albumTitle = columnText( stmt, 3 );
+                data.albumArtwork = columnText( stmt, 4 );
+            }
+            if ( sqlite3_column_type( stmt, 5 ) != SQLITE_NULL )
+            {
+                data.hasArtist = true;
+                data.artistName = columnText( stmt, 6 );
+            }
+        });
+    }
+    if ( res == true && videoIds.empty() == false )
+    {
+        res = run( "SELECT media_id, width, height FROM VideoTrack WHERE media_id IN (" + videoIds + ") ORDER BY id_track",
+                [this]( sqlite3_stmt* stmt ) {
+            auto& data = m_data[sqlite3_column_int64( stmt, 0 )];
+            if ( data.hasVideoTrack == true )
+                return;
+            data.hasVideoTrack = true;
+            data.width = sqlite3_column_int( stmt, 1 );
+            data.height = sqlite3_column_int( stmt, 2 );
+        });
+    }
+    // Partial data would be worse than none: let the slow path handle this window
+    if ( res == false )
+        m_data.clear();
+}
+
+const MediaConvertor::MediaData*
+MediaConvertor::data( int64_t mediaId ) const
+{
+    auto it = m_data.find( mediaId );
+    if ( it == end( m_data ) || it->second.mrl.empty() == true )
+        return nullptr;
+    return &it->second;
+}
+
+media_item*
+MediaConvertor::operator()( MediaPtr media )
+{
+    auto it = m_data.find( media->id() );
+    if ( it == end( m_data ) || it->second.mrl.empty() == true )
+        return fileToMediaItem( media );
+    return mediaDataToMediaItem( media, it->second );
 }
 
 album_item*
-albumToAlbumItem( AlbumPtr album )
+albumToAlbumItem( AlbumPtr album, const LibraryStatistics* stats )
 {
     auto p_item = album_item_create(album->title().c_str());
     if (p_item == nullptr)
@@ -156,11 +356,17 @@ albumToAlbumItem( AlbumPtr album )
     p_item->i_release_date = album->releaseYear();
     p_item->i_nb_tracks = album->nbTracks();
     p_item->psz_artwork = path_from_url(album->artworkMrl().c_str());
+    if ( stats != nullptr && stats->valid == true )
+    {
+        auto it = stats->albums.find( album->id() );
+        if ( it != end( stats->albums ) )
+            p_item->i_duration = it->second.duration;
+    }
     return p_item;
 }
 
 artist_item*
-artistToArtistItem( ArtistPtr artist )
+artistToArtistItem( ArtistPtr artist, const LibraryStatistics* stats )
 {
     auto p_item = artist_item_create(artist->name().c_str());
     if (p_item == nullptr)
@@ -169,18 +375,42 @@ artistToArtistItem( ArtistPtr artist )
     if (artist->artworkMrl().empty() == false)
         p_item->psz_artwork = path_from_url( artist->artworkMrl().c_str() );
 
-    auto albums = artist->albums();
-    p_item->i_nb_albums = albums.size();
+    if ( stats != nullptr && stats->valid == true )
+    {
+        auto it = stats->artists.find( artist->id() );
+        if ( it != end( stats->artists ) )
+        {
+            p_item->i_nb_albums = it->second.nbAlbums;
+            p_item->i_nb_tracks = it->second.nbTracks;
+            p_item->i_duration = it->second.duration;
+        }
+    }
+    else
+    {
+        // Slow path: one more query per artist
+        auto albums = artist->albums();
+        p_item->i_nb_albums = albums.size();
+    }
     return p_item;
 }
 
 genre_item*
-genreToGenreItem( GenrePtr genre )
+genreToGenreItem( GenrePtr genre, const LibraryStatistics* stats )
 {
     auto p_item = genre_item_create( genre->name().c_str() );
     if ( p_item == nullptr )
         return nullptr;
     p_item->i_id = genre->id();
+    if ( stats != nullptr && stats->valid == true )
+    {
+        auto it = stats->genres.find( genre->id() );
+        if ( it != end( stats->genres ) )
+        {
+            p_item->i_nb_albums = it->second.nbAlbums;
+            p_item->i_nb_tracks = it->second.nbTracks;
+            p_item->i_duration = it->second.duration;
+        }
+    }
     return p_item;
 }
 
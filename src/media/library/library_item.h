@@ -27,6 +27,9 @@
  #ifndef LIBRARY_ITEM_H_
  # define LIBRARY_ITEM_H_
 
+#include <stdbool.h>
+#include <string.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -44,7 +47,17 @@ typedef enum library_item_type
 } library_item_type;
 
 #define LIBRARY_ITEM_COMMON \
-    library_item_type i_library_item_type;
+    library_item_type i_library_item_type; \
+    int64_t i_id;   /* Opaque type specific ID, provided by the media library, 0 if unknown */
+
+/* NULL safe string comparison, for the *_item_equals functions */
+static inline bool
+library_item_str_equals(const char* psz_left, const char* psz_right)
+{
+    if (psz_left == NULL || psz_right == NULL)
+        return psz_left == psz_right;
+    return strcmp(psz_left, psz_right) == 0;
+}
 
 #ifdef __cplusplus
 }
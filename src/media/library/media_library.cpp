@@ -26,86 +26,231 @@
 
 #include "common.h"
 
+#include <algorithm>
+
 #include <Ecore.h>
+#include <sqlite3.h>
 
 #include "IMediaLibrary.h"
 #include "IVideoTrack.h"
 #include "IArtist.h"
 #include "IAlbum.h"
+#include "IFile.h"
 #include "IGenre.h"
 #include "IPlaylist.h"
 #include "media_library_private.hpp"
 #include "system_storage.h"
 
+/* Number of threads used to run the list queries concurrently */
+#define ML_QUERY_WORKERS 2
+
+/* Number of items for which the conversion data is fetched at once */
+#define ML_CONVERSION_WINDOW 500
+
+/*
+ * Results up to this size only fetch their own sort order. Above it, sorting
+ * the whole table is cheaper than sending it all the IDs.
+ */
+#define ML_SORT_MAX_FILTERED 1000
+
+/* Maximum number of results returned by a search */
+#define ML_SEARCH_MAX_RESULTS 50
+
+/*
+ * Version of the medialibrary database the direct queries of the convertors,
+ * sorting and statistics were written for. Update it along with them when
+ * moving to a newer medialibrary.
+ */
+#define ML_DB_MODEL_VERSION 2
+
 media_library::media_library()
     : ml( NewMediaLibrary() )
+    , executor( std::make_shared<QueryExecutor>( ML_QUERY_WORKERS ) )
+    , m_pendingAdded( nullptr )
+    , m_pendingUpdated( nullptr )
+    , m_updatesScheduled( false )
     , m_progressCb( nullptr )
     , m_progressData( nullptr )
-
 {
     if ( ml == nullptr )
         throw std::runtime_error( "Failed to initialize MediaLibrary" );
 }
 
+media_library::~media_library()
+{
+    // The queries use the medialibrary, and refer to this instance
+    executor->shutdown();
+    // Release the medialibrary before the rest, so no more updates get queued
+    ml.reset();
+    void* item;
+    EINA_LIST_FREE( m_pendingAdded, item )
+        media_item_destroy( reinterpret_cast<media_item*>( item ) );
+    EINA_LIST_FREE( m_pendingUpdated, item )
+        media_item_destroy( reinterpret_cast<media_item*>( item ) );
+}
+
 void
 media_library::onMediaAdded( std::vector<MediaPtr> media )
 {
-    for ( const auto& m : media )
-        sendFileUpdate( m, true );
+    sendFileUpdates( media, true );
 }
 
 void
 media_library::onMediaUpdated( std::vector<MediaPtr> media )
 {
-    for ( const auto& m : media )
-        sendFileUpdate( m, false );
+    sendFileUpdates( media, false );
 }
 
 void media_library::onMediaDeleted( std::vector<int64_t> ids )
 {
+    for ( auto id : ids )
+        searchIndex.remove( LIBRARY_ITEM_MEDIA, id );
+    sendDeletions( LIBRARY_ITEM_MEDIA, ids );
 }
 
 
 void media_library::onArtistsAdded( std::vector<ArtistPtr> artists )
 {
+    for ( const auto& a : artists )
+        searchIndex.add( LIBRARY_ITEM_ARTIST, a->id(), { a->name() } );
 }
 
-void media_library::onArtistsModified( std::vector<ArtistPtr> artist )
+void media_library::onArtistsModified( std::vector<ArtistPtr> artists )
 {
+    onArtistsAdded( std::move( artists ) );
 }
 
 void media_library::onArtistsDeleted( std::vector<int64_t> ids )
 {
+    for ( auto id : ids )
+        searchIndex.remove( LIBRARY_ITEM_ARTIST, id );
+    sendDeletions( LIBRARY_ITEM_ARTIST, ids );
 }
 
 void media_library::onAlbumsAdded( std::vector<AlbumPtr> albums )
 {
+    for ( const auto& a : albums )
+        searchIndex.add( LIBRARY_ITEM_ALBUM, a->id(), { a->title() } );
 }
 
 void media_library::onAlbumsModified( std::vector<AlbumPtr> albums )
 {
+    onAlbumsAdded( std::move( albums ) );
 }
 
 void media_library::onAlbumsDeleted( std::vector<int64_t> ids )
 {
+    for ( auto id : ids )
+        searchIndex.remove( LIBRARY_ITEM_ALBUM, id );
+    sendDeletions( LIBRARY_ITEM_ALBUM, ids );
 }
 
+/*
+ * Converted items are accumulated until the main loop gets a chance to run,
+ * so that all the updates received in the meantime get delivered in a single
+ * dispatch, instead of waking up the main loop once per media.
+ */
 void
-media_library::sendFileUpdate( MediaPtr file, bool added )
+media_library::sendFileUpdates( const std::vector<MediaPtr>& media, bool added )
 {
-    auto item = fileToMediaItem( file );
-    auto ctx = new FileUpdateCallbackCtx{this, item, added};
+    Eina_List* items = nullptr;
+    MediaConvertor convertor( dbPath );
+    convertor.prepare( media, 0, media.size() );
+    for ( const auto& m : media )
+    {
+        auto item = convertor( m );
+        if ( item == nullptr )
+            continue;
+        indexMediaItem( searchIndex, item );
+        items = eina_list_append( items, item );
+    }
+    if ( items == nullptr )
+        return;
+
+    std::lock_guard<std::mutex> lock( m_updatesLock );
+    if ( added == true )
+        m_pendingAdded = eina_list_merge( m_pendingAdded, items );
+    else
+        m_pendingUpdated = eina_list_merge( m_pendingUpdated, items );
+    scheduleFlush();
+}
+
+void
+media_library::sendDeletions( library_item_type type, const std::vector<int64_t>& ids )
+{
+    if ( ids.empty() == true )
+        return;
+    std::lock_guard<std::mutex> lock( m_updatesLock );
+    auto& pending = m_pendingDeleted[type];
+    pending.insert( end( pending ), begin( ids ), end( ids ) );
+    scheduleFlush();
+}
+
+/* Needs to be called with m_updatesLock held */
+void
+media_library::scheduleFlush()
+{
+    if ( m_updatesScheduled == true )
+        return;
+    m_updatesScheduled = true;
+    auto ctx = new FileUpdateCallbackCtx{ this };
     ecore_main_loop_thread_safe_call_async([](void* data) {
         std::unique_ptr<FileUpdateCallbackCtx> ctx( reinterpret_cast<FileUpdateCallbackCtx*>(data) );
         auto ml = ctx->wml.lock();
         if ( ml == nullptr )
             return;
-        for ( auto& p : ctx->ml->m_onItemUpdatedCb )
+        ctx->ml->flushFileUpdates();
+    }, ctx);
+}
+
+void
+media_library::flushFileUpdates()
+{
+    Eina_List* added;
+    Eina_List* updated;
+    std::map<library_item_type, std::vector<int64_t>> deleted;
+    {
+        std::lock_guard<std::mutex> lock( m_updatesLock );
+        added = m_pendingAdded;
+        updated = m_pendingUpdated;
+        m_pendingAdded = nullptr;
+        m_pendingUpdated = nullptr;
+        std::swap( deleted, m_pendingDeleted );
+        m_updatesScheduled = false;
+    }
+    // Send additions first, so updates of a freshly added media aren't overwritten,
+    // and deletions last, so a media removed right after its insertion doesn't come back
+    dispatchFileUpdates( added, true );
+    dispatchFileUpdates( updated, false );
+    for ( const auto& p : deleted )
+    {
+        for ( auto& cb : m_onItemsDeletedCb )
+            cb.first( cb.second, p.first, p.second.data(), p.second.size() );
+    }
+}
+
+void
+media_library::dispatchFileUpdates( Eina_List* items, bool added )
+{
+    if ( items == nullptr )
+        return;
+    for ( auto& p : m_onItemsUpdatedCb )
+        p.first( p.second, items, added );
+    void* item;
+    if ( m_onItemUpdatedCb.empty() == false )
+    {
+        Eina_List* it;
+        EINA_LIST_FOREACH( items, it, item )
         {
-            if ( p.first( p.second, reinterpret_cast<library_item*>(ctx->item.get()), ctx->added ) == true )
-                break;
+            for ( auto& p : m_onItemUpdatedCb )
+            {
+                if ( p.first( p.second, reinterpret_cast<library_item*>( item ), added ) == true )
+                    break;
+            }
         }
-    }, ctx);
+    }
+    EINA_LIST_FREE( items, item )
+        media_item_destroy( reinterpret_cast<media_item*>( item ) );
 }
 
 void
@@ -140,6 +285,96 @@ media_library::onReloadCompleted( const std::string& entryPoint )
     {
         ecore_main_loop_thread_safe_call_async( p.first, p.second );
     }
+    auto ctx = new FileUpdateCallbackCtx{ this };
+    ecore_main_loop_thread_safe_call_async([](void* data) {
+        std::unique_ptr<FileUpdateCallbackCtx> ctx( reinterpret_cast<FileUpdateCallbackCtx*>(data) );
+        auto ml = ctx->wml.lock();
+        if ( ml == nullptr )
+            return;
+        ctx->ml->scheduleSearchIndexRebuild();
+    }, ctx);
+}
+
+/*
+ * Search index
+ */
+void
+media_library::indexMediaItem( SearchIndex& index, const media_item* item )
+{
+    auto title = media_item_title( item );
+    std::vector<std::string> fields;
+    fields.emplace_back( title != nullptr ? title : media_item_get_filename( item ) );
+    for ( auto meta : { MEDIA_ITEM_META_ARTIST, MEDIA_ITEM_META_ALBUM, MEDIA_ITEM_META_GENRE } )
+    {
+        if ( item->psz_metas[meta] != nullptr )
+            fields.emplace_back( item->psz_metas[meta] );
+    }
+    fields.emplace_back( media_item_get_filename( item ) );
+    index.add( LIBRARY_ITEM_MEDIA, item->i_id, fields );
+}
+
+/*
+ * Same fields as indexMediaItem, without building a media_item. The related
+ * entities come from the bulk data when available, otherwise only the title
+ * and the file name are indexed.
+ */
+void
+media_library::indexMedia( SearchIndex& index, MediaPtr media, const MediaConvertor::MediaData* data )
+{
+    std::string mrl;
+    if ( data != nullptr )
+        mrl = data->mrl;
+    else
+    {
+        auto files = media->files();
+        if ( files.empty() == false )
+            mrl = files[0]->mrl();
+    }
+    auto pos = mrl.rfind( '/' );
+    auto fileName = pos != std::string::npos ? mrl.substr( pos + 1 ) : mrl;
+
+    std::vector<std::string> fields;
+    fields.push_back( media->title().empty() == false ? media->title() : fileName );
+    if ( data != nullptr && data->hasArtist == true )
+        fields.push_back( data->artistName );
+    if ( data != nullptr && data->hasAlbum == true )
+        fields.push_back( data->albumTitle );
+    fields.push_back( std::move( fileName ) );
+    index.add( LIBRARY_ITEM_MEDIA, media->id(), fields );
+}
+
+bool
+media_library::fillSearchIndex( SearchIndex& index, const QueryExecutor::Token& token )
+{
+    for ( const auto& media : { ml->audioFiles(), ml->videoFiles() } )
+    {
+        MediaConvertor convertor( dbPath );
+        for ( size_t i = 0; i < media.size(); ++i )
+        {
+            if ( token.isCancelled() == true )
+                return false;
+            if ( i % ML_CONVERSION_WINDOW == 0 )
+                convertor.prepare( media, i, std::min<size_t>( i + ML_CONVERSION_WINDOW, media.size() ) );
+            indexMedia( index, media[i], convertor.data( media[i]->id() ) );
+        }
+    }
+    for ( const auto& a : ml->albums() )
+        index.add( LIBRARY_ITEM_ALBUM, a->id(), { a->title() } );
+    for ( const auto& a : ml->artists() )
+        index.add( LIBRARY_ITEM_ARTIST, a->id(), { a->name() } );
+    for ( const auto& g : ml->genres() )
+        index.add( LIBRARY_ITEM_GENRE, g->id(), { g->name() } );
+    return token.isCancelled() == false;
+}
+
+void
+media_library::scheduleSearchIndexRebuild()
+{
+    // Building the index is never more important than what's displayed
+    executor->setPriority( &searchIndex, ML_QUERY_PRIORITY_PREFETCH );
+    executor->submit( &searchIndex, [this]( const QueryExecutor::Token& token ) {
+        searchIndex.rebuild( [this, &token]( SearchIndex& index ) { return fillSearchIndex( index, token ); }, false );
+    });
 }
 
 void
@@ -167,7 +402,7 @@ media_library::unregisterOnChange(media_library_file_list_changed_cb cb, void* c
     auto ite = end(m_onChangeCb);
     for (auto it = begin(m_onChangeCb); it != ite; ++it)
     {
-        if ((*it).first == cb && (*it).second == cb)
+        if ((*it).first == cb && (*it).second == cbUserData)
         {
             m_onChangeCb.erase(it);
             return;
@@ -187,7 +422,7 @@ media_library::unregisterOnItemUpdated(media_library_item_updated_cb cb, void* u
     auto ite = end(m_onItemUpdatedCb);
     for (auto it = begin(m_onItemUpdatedCb); it != ite; ++it)
     {
-        if ((*it).first == cb && (*it).second == cb)
+        if ((*it).first == cb && (*it).second == userData)
         {
             m_onItemUpdatedCb.erase(it);
             return;
@@ -195,12 +430,54 @@ media_library::unregisterOnItemUpdated(media_library_item_updated_cb cb, void* u
     }
 }
 
+void
+media_library::registerOnItemsUpdated(media_library_items_updated_cb cb, void* userData)
+{
+    m_onItemsUpdatedCb.emplace_back( cb, userData );
+}
+
+void
+media_library::unregisterOnItemsUpdated(media_library_items_updated_cb cb, void* userData)
+{
+    auto ite = end(m_onItemsUpdatedCb);
+    for (auto it = begin(m_onItemsUpdatedCb); it != ite; ++it)
+    {
+        if ((*it).first == cb && (*it).second == userData)
+        {
+            m_onItemsUpdatedCb.erase(it);
+            return;
+        }
+    }
+}
+
+void
+media_library::registerOnItemsDeleted(media_library_items_deleted_cb cb, void* userData)
+{
+    m_onItemsDeletedCb.emplace_back( cb, userData );
+}
+
+void
+media_library::unregisterOnItemsDeleted(media_library_items_deleted_cb cb, void* userData)
+{
+    auto ite = end(m_onItemsDeletedCb);
+    for (auto it = begin(m_onItemsDeletedCb); it != ite; ++it)
+    {
+        if ((*it).first == cb && (*it).second == userData)
+        {
+            m_onItemsDeletedCb.erase(it);
+            return;
+        }
+    }
+}
+
 void media_library::onTracksAdded( std::vector<AlbumTrackPtr> tracks )
 {
 }
 
 void media_library::onTracksDeleted( std::vector<int64_t> trackIds )
 {
+    // Album tracks are only displayed through their media, which deletion
+    // gets signaled by onMediaDeleted
 }
 
 void media_library::registerProgressCb( media_library_scan_progress_cb pf_progress, void* p_data )
@@ -223,6 +500,40 @@ media_library_create(application *p_app)
     }
 }
 
+/*
+ * The medialibrary schema is private, and changes between its versions: the
+ * direct queries are only run against the version they were written for.
+ */
+static bool
+media_library_check_schema( const std::string& dbPath )
+{
+    sqlite3* db;
+    auto rc = sqlite3_open_v2( dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr );
+    if ( rc != SQLITE_OK )
+    {
+        LOGE( "Failed to open %s: %s", dbPath.c_str(), sqlite3_errmsg( db ) );
+        sqlite3_close( db );
+        return false;
+    }
+    sqlite3_busy_timeout( db, 500 );
+    sqlite3_stmt* stmt;
+    auto version = -1;
+    rc = sqlite3_prepare_v2( db, "SELECT db_model_version FROM Settings", -1, &stmt, nullptr );
+    if ( rc == SQLITE_OK )
+    {
+        if ( sqlite3_step( stmt ) == SQLITE_ROW )
+            version = sqlite3_column_int( stmt, 0 );
+        sqlite3_finalize( stmt );
+    }
+    sqlite3_close( db );
+    if ( version != ML_DB_MODEL_VERSION )
+    {
+        LOGW( "Unsupported medialibrary database version %d, direct queries are disabled", version );
+        return false;
+    }
+    return true;
+}
+
 bool
 media_library_start(media_library* p_media_library)
 {
@@ -251,7 +562,14 @@ media_library_start(media_library* p_media_library)
     p_media_library->logger.reset( new TizenLogger );
     p_media_library->ml->setVerbosity( LogLevel::Info );
     p_media_library->ml->setLogger( p_media_library->logger.get() );
-    return p_media_library->ml->initialize( appData + "vlc.db", snapshotPath, p_media_library );
+    auto dbPath = appData + "vlc.db";
+    if ( p_media_library->ml->initialize( dbPath, snapshotPath, p_media_library ) == false )
+        return false;
+    // Without a database path, the API is used instead of the direct queries
+    if ( media_library_check_schema( dbPath ) == true )
+        p_media_library->dbPath = dbPath;
+    p_media_library->scheduleSearchIndexRebuild();
+    return true;
 }
 
 void
@@ -270,157 +588,460 @@ template <typename SourceFunc, typename ConvertorFunc>
 struct ml_callback_context
 {
     ml_callback_context( media_library_list_cb c, void* p_user_data, SourceFunc s, ConvertorFunc conv )
-        : cb(c), list(nullptr), p_data(p_user_data)
-          , source(s), convertor(conv){}
+        : cb(c), p_data(p_user_data)
+          , source(s), convertor(conv)
+          , offset(0), count(0), batch_size(0){}
     media_library_list_cb cb;
-    Eina_List* list;
     void* p_data;
     SourceFunc source;
     ConvertorFunc convertor;
+    // Range of the source results to convert. A 0 count means "up to the end"
+    size_t offset;
+    size_t count;
+    // When non 0, converted items are sent by batches of batch_size elements
+    size_t batch_size;
+    SortOptions sort;
+    std::string dbPath;
 };
 
-template <typename SourceFunc, typename ConvertorFunc>
-void
+static void
+library_item_destroy( void* p_data )
+{
+    auto p_item = reinterpret_cast<library_item*>( p_data );
+    switch ( p_item->i_library_item_type )
+    {
+    case LIBRARY_ITEM_MEDIA:
+        media_item_destroy( reinterpret_cast<media_item*>( p_item ) );
+        break;
+    case LIBRARY_ITEM_ALBUM:
+        album_item_destroy( reinterpret_cast<album_item*>( p_item ) );
+        break;
+    case LIBRARY_ITEM_ARTIST:
+        artist_item_destroy( reinterpret_cast<artist_item*>( p_item ) );
+        break;
+    case LIBRARY_ITEM_GENRE:
+        genre_item_destroy( reinterpret_cast<genre_item*>( p_item ) );
+        break;
+    case LIBRARY_ITEM_PLAYLIST:
+        playlist_item_destroy( reinterpret_cast<playlist_item*>( p_item ) );
+        break;
+    }
+}
+
+struct ml_list_result
+{
+    ml_list_result( media_library_list_cb c, Eina_List* l, void* p_user_data, const QueryExecutor::Token& t )
+        : cb(c), list(l), p_data(p_user_data), token(t){}
+    media_library_list_cb cb;
+    Eina_List* list;
+    void* p_data;
+    QueryExecutor::Token token;
+};
+
+static void
 intermediate_list_callback( void* p_data )
 {
-    auto ctx = reinterpret_cast<ml_callback_context<SourceFunc, ConvertorFunc>*>( p_data );
-    ctx->cb( ctx->list, ctx->p_data );
-    delete ctx;
+    std::unique_ptr<ml_list_result> res( reinterpret_cast<ml_list_result*>( p_data ) );
+    // The owner may have been destroyed, or have issued a new query since
+    if ( res->token.isCancelled() == true )
+    {
+        void* p_item;
+        EINA_LIST_FREE( res->list, p_item )
+            library_item_destroy( p_item );
+        return;
+    }
+    res->cb( res->list, res->p_data );
+}
+
+static void
+media_library_send_list( media_library_list_cb cb, Eina_List* list, void* p_user_data, const QueryExecutor::Token& token )
+{
+    auto res = new ml_list_result( cb, list, p_user_data, token );
+    ecore_main_loop_thread_safe_call_async( intermediate_list_callback, res );
 }
 
-template <typename SourceFunc, typename ConvertorFunc>
-static void media_library_common_getter(media_library_list_cb cb, void* p_user_data, SourceFunc source, ConvertorFunc conv)
+struct ml_sections_result
 {
-    auto ctx = new ml_callback_context<SourceFunc, ConvertorFunc>( cb, p_user_data, source, conv );
+    ml_sections_result( media_library_sections_cb c, std::vector<media_library_section> s, void* p_user_data, const QueryExecutor::Token& t )
+        : cb(c), sections(std::move(s)), p_data(p_user_data), token(t){}
+    media_library_sections_cb cb;
+    std::vector<media_library_section> sections;
+    void* p_data;
+    QueryExecutor::Token token;
+};
+
+/*
+ * Sections are sent through the same queue as the lists, so they are always
+ * received right before the list they refer to.
+ */
+static void
+media_library_send_sections( media_library_sections_cb cb, std::vector<media_library_section>& sections, void* p_user_data, const QueryExecutor::Token& token )
+{
+    if ( cb == nullptr || sections.empty() == true )
+        return;
+    auto res = new ml_sections_result( cb, std::move( sections ), p_user_data, token );
+    sections.clear();
+    ecore_main_loop_thread_safe_call_async( []( void* p_data ) {
+        std::unique_ptr<ml_sections_result> res( reinterpret_cast<ml_sections_result*>( p_data ) );
+        if ( res->token.isCancelled() == true )
+            return;
+        res->cb( res->p_data, res->sections.data(), res->sections.size() );
+    }, res );
+}
+
+static library_item_type item_type( const MediaPtr& ) { return LIBRARY_ITEM_MEDIA; }
+static library_item_type item_type( const AlbumPtr& ) { return LIBRARY_ITEM_ALBUM; }
+static library_item_type item_type( const ArtistPtr& ) { return LIBRARY_ITEM_ARTIST; }
+static library_item_type item_type( const GenrePtr& ) { return LIBRARY_ITEM_GENRE; }
+static library_item_type item_type( const PlaylistPtr& ) { return LIBRARY_ITEM_PLAYLIST; }
 
-    ecore_thread_run( [](void* data, Ecore_Thread* ) {
-        auto ctx = reinterpret_cast<ml_callback_context<SourceFunc, ConvertorFunc>*>( data );
+/*
+ * Reorders the items as the database tells us to, and returns the section
+ * label of each of them, if requested.
+ * Items the sort query didn't return are kept at the end, in their original
+ * order, so that a database read failure can't lose results.
+ */
+template <typename T>
+static std::vector<std::string> media_library_sort_items( const std::string& dbPath, std::vector<T>& items, const SortOptions& options )
+{
+    std::vector<std::string> labels;
+    if ( options.key == ML_SORT_DEFAULT || items.empty() == true )
+        return labels;
+    // A single item still needs its section label
+    if ( items.size() == 1 && options.sectionsCb == nullptr )
+        return labels;
+    std::vector<int64_t> ids;
+    if ( items.size() <= ML_SORT_MAX_FILTERED )
+    {
+        ids.reserve( items.size() );
+        for ( const auto& item : items )
+            ids.push_back( item->id() );
+    }
+    std::vector<SortEntry> order;
+    if ( fetchSortOrder( dbPath, item_type( items[0] ), options, ids, order ) == false )
+        return labels;
+
+    std::unordered_map<int64_t, size_t> positions;
+    positions.reserve( items.size() );
+    for ( size_t i = 0; i < items.size(); ++i )
+        positions.emplace( items[i]->id(), i );
+    std::vector<T> sorted;
+    sorted.reserve( items.size() );
+    labels.reserve( items.size() );
+    for ( auto& entry : order )
+    {
+        auto it = positions.find( entry.id );
+        // Not part of this result, or already seen through another join row
+        if ( it == end( positions ) )
+            continue;
+        sorted.push_back( std::move( items[it->second] ) );
+        labels.push_back( std::move( entry.label ) );
+        positions.erase( it );
+    }
+    for ( auto& item : items )
+    {
+        if ( item == nullptr )
+            continue;
+        sorted.push_back( std::move( item ) );
+        labels.emplace_back();
+    }
+    items = std::move( sorted );
+    return labels;
+}
+
+/*
+ * Gives the convertor a chance to fetch the data it needs for a whole range
+ * of items at once. Only MediaConvertor supports it.
+ */
+template <typename ConvertorFunc, typename Items>
+static void prepare_conversion( ConvertorFunc&, const Items&, size_t, size_t )
+{
+}
+
+static void prepare_conversion( MediaConvertor& conv, const std::vector<MediaPtr>& items, size_t first, size_t last )
+{
+    conv.prepare( items, first, last );
+}
+
+template <typename SourceFunc, typename ConvertorFunc>
+static void media_library_run_getter(media_library* p_ml, ml_callback_context<SourceFunc, ConvertorFunc>* c)
+{
+    std::shared_ptr<ml_callback_context<SourceFunc, ConvertorFunc>> ctx( c );
+    auto sort = p_ml->sortOptions.find( ctx->p_data );
+    if ( sort != end( p_ml->sortOptions ) )
+        ctx->sort = sort->second;
+    ctx->dbPath = p_ml->dbPath;
+    p_ml->executor->submit( ctx->p_data, [ctx](const QueryExecutor::Token& token) {
+        if ( token.isCancelled() == true )
+            return;
         auto items = ctx->source();
+        auto labels = media_library_sort_items( ctx->dbPath, items, ctx->sort );
+        std::vector<media_library_section> sections;
+        const std::string* lastLabel = nullptr;
+        size_t nb_converted = 0;
+        auto first = std::min( ctx->offset, items.size() );
+        auto last = items.size();
+        if ( ctx->count != 0 )
+            last = std::min( first + ctx->count, last );
+        // A page only reports the sections starting in it, at their index in the whole result
+        if ( first > 0 && labels.empty() == false && labels[first - 1].empty() == false )
+            lastLabel = &labels[first - 1];
+
         Eina_List *list = nullptr;
-        for ( auto& f : items )
+        size_t nb_items = 0;
+        for ( auto i = first; i < last; ++i )
         {
-            auto elem = ctx->convertor( f );
+            // Don't bother converting results nobody is waiting for anymore
+            if ( token.isCancelled() == true )
+            {
+                void* p_item;
+                EINA_LIST_FREE( list, p_item )
+                    library_item_destroy( p_item );
+                return;
+            }
+            if ( ( i - first ) % ML_CONVERSION_WINDOW == 0 )
+                prepare_conversion( ctx->convertor, items, i, std::min<size_t>( i + ML_CONVERSION_WINDOW, last ) );
+            auto elem = ctx->convertor( items[i] );
             if ( elem == nullptr )
                 continue;
             list = eina_list_append( list, elem );
+            if ( labels.empty() == false && labels[i].empty() == false &&
+                 ( lastLabel == nullptr || *lastLabel != labels[i] ) )
+            {
+                media_library_section section;
+                strncpy( section.psz_label, labels[i].c_str(), sizeof( section.psz_label ) - 1 );
+                section.psz_label[sizeof( section.psz_label ) - 1] = 0;
+                section.i_index = first + nb_converted;
+                sections.push_back( section );
+                lastLabel = &labels[i];
+            }
+            ++nb_converted;
+            if ( ctx->batch_size != 0 && ++nb_items == ctx->batch_size )
+            {
+                media_library_send_sections( ctx->sort.sectionsCb, sections, ctx->p_data, token );
+                media_library_send_list( ctx->cb, list, ctx->p_data, token );
+                list = nullptr;
+                nb_items = 0;
+            }
         }
-        ctx->list = list;
-        ecore_main_loop_thread_safe_call_async( intermediate_list_callback<SourceFunc, ConvertorFunc>, ctx );
-    }, nullptr, nullptr, ctx );
+        media_library_send_sections( ctx->sort.sectionsCb, sections, ctx->p_data, token );
+        if ( ctx->batch_size == 0 )
+        {
+            media_library_send_list( ctx->cb, list, ctx->p_data, token );
+            return;
+        }
+        if ( list != nullptr )
+            media_library_send_list( ctx->cb, list, ctx->p_data, token );
+        // Signal the end of the stream
+        media_library_send_list( ctx->cb, nullptr, ctx->p_data, token );
+    });
+}
+
+template <typename SourceFunc, typename ConvertorFunc>
+static void media_library_common_getter(media_library* p_ml, media_library_list_cb cb, void* p_user_data, SourceFunc source, ConvertorFunc conv)
+{
+    auto ctx = new ml_callback_context<SourceFunc, ConvertorFunc>( cb, p_user_data, source, conv );
+    media_library_run_getter( p_ml, ctx );
+}
+
+template <typename SourceFunc, typename ConvertorFunc>
+static void media_library_paged_getter(media_library* p_ml, size_t offset, size_t count, media_library_list_cb cb, void* p_user_data, SourceFunc source, ConvertorFunc conv)
+{
+    auto ctx = new ml_callback_context<SourceFunc, ConvertorFunc>( cb, p_user_data, source, conv );
+    ctx->offset = offset;
+    ctx->count = count;
+    media_library_run_getter( p_ml, ctx );
+}
+
+template <typename SourceFunc, typename ConvertorFunc>
+static void media_library_streamed_getter(media_library* p_ml, size_t batch_size, media_library_list_cb cb, void* p_user_data, SourceFunc source, ConvertorFunc conv)
+{
+    auto ctx = new ml_callback_context<SourceFunc, ConvertorFunc>( cb, p_user_data, source, conv );
+    ctx->batch_size = batch_size > 0 ? batch_size : 1;
+    media_library_run_getter( p_ml, ctx );
 }
 
 void
 media_library_get_audio_files( media_library* p_ml, media_library_list_cb cb, void* p_user_data )
 {
-    media_library_common_getter(cb, p_user_data,
+    media_library_common_getter(p_ml, cb, p_user_data,
             [p_ml](){ return p_ml->ml->audioFiles(); },
-            fileToMediaItem);
+            MediaConvertor( p_ml->dbPath ));
 }
 
 void
 media_library_get_video_files( media_library* p_ml, media_library_list_cb cb, void* p_user_data )
 {
-    media_library_common_getter(cb, p_user_data,
+    media_library_common_getter(p_ml, cb, p_user_data,
             [p_ml](){ return p_ml->ml->videoFiles(); },
-            fileToMediaItem);
+            MediaConvertor( p_ml->dbPath ));
 }
 
+void
+media_library_get_audio_files_paged( media_library* p_ml, unsigned int i_offset, unsigned int i_count, media_library_list_cb cb, void* p_user_data )
+{
+    media_library_paged_getter(p_ml, i_offset, i_count, cb, p_user_data,
+            [p_ml](){ return p_ml->ml->audioFiles(); },
+            MediaConvertor( p_ml->dbPath ));
+}
+
+void
+media_library_get_video_files_paged( media_library* p_ml, unsigned int i_offset, unsigned int i_count, media_library_list_cb cb, void* p_user_data )
+{
+    media_library_paged_getter(p_ml, i_offset, i_count, cb, p_user_data,
+            [p_ml](){ return p_ml->ml->videoFiles(); },
+            MediaConvertor( p_ml->dbPath ));
+}
+
+void
+media_library_get_audio_files_streamed( media_library* p_ml, unsigned int i_batch_size, media_library_list_cb cb, void* p_user_data )
+{
+    media_library_streamed_getter(p_ml, i_batch_size, cb, p_user_data,
+            [p_ml](){ return p_ml->ml->audioFiles(); },
+            MediaConvertor( p_ml->dbPath ));
+}
+
+void
+media_library_get_video_files_streamed( media_library* p_ml, unsigned int i_batch_size, media_library_list_cb cb, void* p_user_data )
+{
+    media_library_streamed_getter(p_ml, i_batch_size, cb, p_user_data,
+            [p_ml](){ return p_ml->ml->videoFiles(); },
+            MediaConvertor( p_ml->dbPath ));
+}
+
+/*
+ * The statistics are fetched by the source function, and used by the
+ * convertor, both being run sequentially from the same worker thread.
+ */
 void
 media_library_get_albums(media_library* p_ml, media_library_list_cb cb, void* p_user_data)
 {
-    media_library_common_getter(cb, p_user_data,
-            [p_ml](){ return p_ml->ml->albums(); },
-            albumToAlbumItem);
+    auto stats = std::make_shared<LibraryStatistics>();
+    media_library_common_getter(p_ml, cb, p_user_data,
+            [p_ml, stats](){
+                fetchLibraryStatistics( p_ml->dbPath, *stats );
+                return p_ml->ml->albums();
+            },
+            [stats](AlbumPtr album) { return albumToAlbumItem( album, stats.get() ); });
 }
 
 void
 media_library_get_artists( media_library* p_ml, media_library_list_cb cb, void* p_user_data )
 {
-    media_library_common_getter(cb, p_user_data,
-                [p_ml](){ return p_ml->ml->artists(); },
-                artistToArtistItem);
+    auto stats = std::make_shared<LibraryStatistics>();
+    media_library_common_getter(p_ml, cb, p_user_data,
+                [p_ml, stats](){
+                    fetchLibraryStatistics( p_ml->dbPath, *stats );
+                    return p_ml->ml->artists();
+                },
+                [stats](ArtistPtr artist) { return artistToArtistItem( artist, stats.get() ); });
 }
 
 void
 media_library_get_genres( media_library* p_ml, media_library_list_cb cb, void* p_user_data )
 {
-    media_library_common_getter(cb, p_user_data,
-            [p_ml](){ return p_ml->ml->genres();
-        }, genreToGenreItem);
+    auto stats = std::make_shared<LibraryStatistics>();
+    media_library_common_getter(p_ml, cb, p_user_data,
+            [p_ml, stats](){
+                fetchLibraryStatistics( p_ml->dbPath, *stats );
+                return p_ml->ml->genres();
+            },
+            [stats](GenrePtr genre) { return genreToGenreItem( genre, stats.get() ); });
 }
 
 void
 media_library_get_playlists( media_library* p_ml, media_library_list_cb cb, void* p_user_data )
 {
-    media_library_common_getter( cb, p_user_data,
+    media_library_common_getter( p_ml, cb, p_user_data,
             [p_ml](){ return p_ml->ml->playlists();
         }, playlistToPlaylistItem );
 }
 
+/*
+ * The entity lookups below are part of the source function, so that they
+ * happen on the worker thread along with the listing. An unknown entity
+ * yields an empty result, which the callback receives as a NULL list.
+ */
 void
 media_library_get_artist_albums( media_library* p_ml, int64_t i_artist_id, media_library_list_cb cb, void* p_user_data )
 {
-    ArtistPtr artist = p_ml->ml->artist( i_artist_id );
-    if (artist == nullptr)
-    {
-        LOGE("Can't find artist %d", i_artist_id);
-        return;
-    }
-    media_library_common_getter(cb, p_user_data,
-                [artist](){ return artist->albums(); },
-                &albumToAlbumItem);
+    auto stats = std::make_shared<LibraryStatistics>();
+    media_library_common_getter(p_ml, cb, p_user_data,
+                [p_ml, i_artist_id, stats]() -> std::vector<AlbumPtr> {
+                    auto artist = p_ml->ml->artist( i_artist_id );
+                    if ( artist == nullptr )
+                    {
+                        LOGE("Can't find artist %lld", i_artist_id);
+                        return {};
+                    }
+                    fetchLibraryStatistics( p_ml->dbPath, *stats );
+                    return artist->albums();
+                },
+                [stats](AlbumPtr album) { return albumToAlbumItem( album, stats.get() ); });
 }
 
 void
 media_library_get_album_songs(media_library* p_ml, int64_t i_album_id, media_library_list_cb cb, void* p_user_data)
 {
-    auto album = p_ml->ml->album(i_album_id);
-    if (album == nullptr)
-    {
-        LOGE("Can't find album #%d", i_album_id);
-        return;
-    }
-    media_library_common_getter(cb, p_user_data,
-            [album](){ return album->tracks(); },
-            fileToMediaItem);
+    media_library_common_getter(p_ml, cb, p_user_data,
+            [p_ml, i_album_id]() -> std::vector<MediaPtr> {
+                auto album = p_ml->ml->album( i_album_id );
+                if ( album == nullptr )
+                {
+                    LOGE("Can't find album #%lld", i_album_id);
+                    return {};
+                }
+                return album->tracks();
+            },
+            MediaConvertor( p_ml->dbPath ));
 }
 
 void
 media_library_get_artist_songs(media_library* p_ml, int64_t i_artist_id, media_library_list_cb cb, void* p_user_data)
 {
-    ArtistPtr artist = p_ml->ml->artist(i_artist_id);
-    if (artist == nullptr)
-    {
-        LOGE("Can't find artist %u", i_artist_id);
-        return;
-    }
-    media_library_common_getter(cb, p_user_data,
-                [artist](){ return artist->media(); },
-                &fileToMediaItem);
+    media_library_common_getter(p_ml, cb, p_user_data,
+                [p_ml, i_artist_id]() -> std::vector<MediaPtr> {
+                    auto artist = p_ml->ml->artist( i_artist_id );
+                    if ( artist == nullptr )
+                    {
+                        LOGE("Can't find artist %lld", i_artist_id);
+                        return {};
+                    }
+                    return artist->media();
+                },
+                MediaConvertor( p_ml->dbPath ));
 }
 
 void
 media_library_get_genres_songs(media_library* p_ml, int64_t i_genre_id, media_library_list_cb cb, void* p_user_data)
 {
-    GenrePtr genre = p_ml->ml->genre(i_genre_id);
-    if ( genre == nullptr )
-    {
-        LOGE("Can't find genre %u", i_genre_id);
-        return;
-    }
-    media_library_common_getter(cb, p_user_data, [genre]{ return genre->tracks(); }, &fileToMediaItem);
+    media_library_common_getter(p_ml, cb, p_user_data,
+            [p_ml, i_genre_id]() -> std::vector<MediaPtr> {
+                auto genre = p_ml->ml->genre( i_genre_id );
+                if ( genre == nullptr )
+                {
+                    LOGE("Can't find genre %lld", i_genre_id);
+                    return {};
+                }
+                return genre->tracks();
+            },
+            MediaConvertor( p_ml->dbPath ));
 }
 
 void
 media_library_get_playlist_songs(media_library* p_ml, int64_t i_playlist_id, media_library_list_cb cb, void* p_user_data)
 {
-    PlaylistPtr playlist = p_ml->ml->playlist(i_playlist_id);
-    if ( playlist == nullptr )
-    {
-        LOGE("Can't find playlist %u", i_playlist_id);
-        return;
-    }
-    media_library_common_getter(cb, p_user_data, [playlist]{ return playlist->media(); }, &fileToMediaItem);
+    media_library_common_getter(p_ml, cb, p_user_data,
+            [p_ml, i_playlist_id]() -> std::vector<MediaPtr> {
+                auto playlist = p_ml->ml->playlist( i_playlist_id );
+                if ( playlist == nullptr )
+                {
+                    LOGE("Can't find playlist %lld", i_playlist_id);
+                    return {};
+                }
+                return playlist->media();
+            },
+            MediaConvertor( p_ml->dbPath ));
 }
 
 void
@@ -480,6 +1101,137 @@ media_library_unregister_item_updated(media_library* ml, media_library_item_upda
     ml->unregisterOnItemUpdated(cb, p_data);
 }
 
+void
+media_library_register_items_updated(media_library* ml, media_library_items_updated_cb cb, void* p_data )
+{
+    ml->registerOnItemsUpdated(cb, p_data);
+}
+
+void
+media_library_unregister_items_updated(media_library* ml, media_library_items_updated_cb cb, void* p_data )
+{
+    ml->unregisterOnItemsUpdated(cb, p_data);
+}
+
+void
+media_library_register_items_deleted(media_library* ml, media_library_items_deleted_cb cb, void* p_data )
+{
+    ml->registerOnItemsDeleted(cb, p_data);
+}
+
+void
+media_library_unregister_items_deleted(media_library* ml, media_library_items_deleted_cb cb, void* p_data )
+{
+    ml->unregisterOnItemsDeleted(cb, p_data);
+}
+
+void
+media_library_search( media_library* p_ml, const char* psz_query, unsigned int i_kinds, media_library_list_cb cb, void* p_user_data )
+{
+    std::string query( psz_query != nullptr ? psz_query : "" );
+    // Cancelling a search mustn't interrupt the index build it may be waiting for
+    auto indexToken = p_ml->executor->token( &p_ml->searchIndex );
+    // Elements of an unordered_map don't move, their address is stable
+    void* owner = &p_ml->searchOwners[p_user_data];
+    p_ml->executor->cancel( owner );
+    p_ml->executor->submit( owner, [p_ml, query, i_kinds, cb, p_user_data, indexToken]( const QueryExecutor::Token& token ) {
+        // In case the initial build isn't over yet, or never happened
+        p_ml->searchIndex.rebuild( [p_ml, &indexToken]( SearchIndex& index ) {
+            return p_ml->fillSearchIndex( index, indexToken );
+        }, true );
+        if ( token.isCancelled() == true )
+            return;
+        auto results = p_ml->searchIndex.search( query, i_kinds, ML_SEARCH_MAX_RESULTS );
+
+        // Fetch the matching items, keeping the results order
+        std::vector<library_item*> items( results.size(), nullptr );
+        std::vector<MediaPtr> media;
+        std::vector<size_t> mediaSlots;
+        for ( size_t i = 0; i < results.size(); ++i )
+        {
+            const auto& r = results[i];
+            switch ( r.type )
+            {
+            case LIBRARY_ITEM_MEDIA:
+            {
+                auto m = p_ml->ml->media( r.id );
+                if ( m == nullptr )
+                    break;
+                media.push_back( m );
+                mediaSlots.push_back( i );
+                break;
+            }
+            case LIBRARY_ITEM_ALBUM:
+            {
+                auto a = p_ml->ml->album( r.id );
+                if ( a != nullptr )
+                    items[i] = reinterpret_cast<library_item*>( albumToAlbumItem( a, nullptr ) );
+                break;
+            }
+            case LIBRARY_ITEM_ARTIST:
+            {
+                auto a = p_ml->ml->artist( r.id );
+                if ( a != nullptr )
+                    items[i] = reinterpret_cast<library_item*>( artistToArtistItem( a, nullptr ) );
+                break;
+            }
+            case LIBRARY_ITEM_GENRE:
+            {
+                auto g = p_ml->ml->genre( r.id );
+                if ( g != nullptr )
+                    items[i] = reinterpret_cast<library_item*>( genreToGenreItem( g, nullptr ) );
+                break;
+            }
+            default:
+                break;
+            }
+        }
+        MediaConvertor convertor( p_ml->dbPath );
+        convertor.prepare( media, 0, media.size() );
+        for ( size_t i = 0; i < media.size(); ++i )
+            items[mediaSlots[i]] = reinterpret_cast<library_item*>( convertor( media[i] ) );
+
+        Eina_List* list = nullptr;
+        for ( auto item : items )
+        {
+            if ( item != nullptr )
+                list = eina_list_append( list, item );
+        }
+        media_library_send_list( cb, list, p_user_data, token );
+    });
+}
+
+void
+media_library_cancel_queries( media_library* p_ml, void* p_user_data )
+{
+    p_ml->executor->cancel( p_user_data );
+    auto it = p_ml->searchOwners.find( p_user_data );
+    if ( it == end( p_ml->searchOwners ) )
+        return;
+    p_ml->executor->cancel( &it->second );
+    p_ml->searchOwners.erase( it );
+}
+
+void
+media_library_set_query_priority( media_library* p_ml, void* p_user_data, media_library_query_priority i_priority )
+{
+    p_ml->executor->setPriority( p_user_data, i_priority );
+}
+
+void
+media_library_set_sort( media_library* p_ml, void* p_user_data, media_library_sort_key i_key, bool b_descending, media_library_sections_cb pf_sections )
+{
+    if ( i_key == ML_SORT_DEFAULT && pf_sections == nullptr )
+    {
+        p_ml->sortOptions.erase( p_user_data );
+        return;
+    }
+    auto& options = p_ml->sortOptions[p_user_data];
+    options.key = i_key;
+    options.descending = b_descending;
+    options.sectionsCb = pf_sections;
+}
+
 void
 media_library_register_progress_cb( media_library* ml, media_library_scan_progress_cb pf_progress, void* p_data )
 {
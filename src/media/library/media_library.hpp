@@ -46,9 +46,68 @@ typedef void (*media_library_list_cb)( Eina_List*, void *p_user_data );
  * There is no warranty about which thread will call this callback.
  */
 typedef bool (*media_library_item_updated_cb)( void *p_user_data, const library_item* p_item, bool b_new );
+/**
+ * Batched variant of media_library_item_updated_cb: all the items that were
+ * added (or updated) since the previous dispatch are provided at once.
+ * The list and its items belong to the media library, and are only valid
+ * for the duration of the call.
+ * This callback is always called from the main loop.
+ */
+typedef void (*media_library_items_updated_cb)( void *p_user_data, Eina_List* p_items, bool b_new );
+
+/**
+ * Signals that the library items of type i_type and IDs pi_ids have been
+ * removed from the media library.
+ * This callback is always called from the main loop.
+ */
+typedef void (*media_library_items_deleted_cb)( void *p_user_data, library_item_type i_type, const int64_t* pi_ids, unsigned int i_nb_ids );
 
 typedef void (*media_library_scan_progress_cb)( void*, uint8_t );
 
+/*
+ * Queries issued by owners (ie. the getters p_user_data) with a visible
+ * priority are always processed before prefetch ones.
+ */
+typedef enum media_library_query_priority
+{
+    ML_QUERY_PRIORITY_VISIBLE,
+    ML_QUERY_PRIORITY_PREFETCH,
+    ML_QUERY_PRIORITY_COUNT
+} media_library_query_priority;
+
+/*
+ * Sort keys, evaluated by the database when running the getters. A key that
+ * doesn't apply to the listed items (ie. a track number for artists) leaves
+ * the results in the default order.
+ */
+typedef enum media_library_sort_key
+{
+    ML_SORT_DEFAULT,
+    ML_SORT_TITLE,
+    ML_SORT_ARTIST,
+    ML_SORT_ALBUM,
+    ML_SORT_DURATION,
+    ML_SORT_INSERTION_DATE,
+    ML_SORT_TRACK_NUMBER
+} media_library_sort_key;
+
+/*
+ * First letter bucket of a sorted result. i_index is the position of the
+ * first item of the section in the whole result, as delivered to the list
+ * callback.
+ */
+typedef struct media_library_section
+{
+    char psz_label[8];
+    unsigned int i_index;
+} media_library_section;
+
+/*
+ * Invoked right before the list callback, with the sections starting in
+ * the upcoming list. This callback is always called from the main loop.
+ */
+typedef void (*media_library_sections_cb)( void* p_user_data, const media_library_section* p_sections, unsigned int i_nb_sections );
+
 media_library*
 media_library_create(application* p_app);
 
@@ -67,6 +126,31 @@ media_library_get_video_files( media_library* p_ml, media_library_list_cb cb, vo
 void
 media_library_get_audio_files( media_library* p_ml, media_library_list_cb cb, void* p_user_data );
 
+/*
+ * Paged getters: only the [i_offset, i_offset + i_count) range of the result
+ * gets converted and sent to the callback. A 0 i_count means "up to the end"
+ */
+void
+media_library_get_video_files_paged( media_library* p_ml, unsigned int i_offset, unsigned int i_count, media_library_list_cb cb, void* p_user_data );
+
+void
+media_library_get_audio_files_paged( media_library* p_ml, unsigned int i_offset, unsigned int i_count, media_library_list_cb cb, void* p_user_data );
+
+/*
+ * Streamed getters: the callback is invoked once per batch of i_batch_size
+ * converted items, as soon as they are ready, and a last time with a NULL
+ * list once the whole result has been sent.
+ */
+void
+media_library_get_video_files_streamed( media_library* p_ml, unsigned int i_batch_size, media_library_list_cb cb, void* p_user_data );
+
+void
+media_library_get_audio_files_streamed( media_library* p_ml, unsigned int i_batch_size, media_library_list_cb cb, void* p_user_data );
+
+/*
+ * The entity lookup is performed asynchronously, along with the listing.
+ * If the artist can't be found, the callback is invoked with a NULL list.
+ */
 void
 media_library_get_artist_albums( media_library* p_ml, int64_t i_artist_id, media_library_list_cb cb, void* p_user_data );
 
@@ -82,6 +166,10 @@ media_library_get_genres( media_library* p_ml, media_library_list_cb cb, void* p
 void
 media_library_get_playlists( media_library* p_ml, media_library_list_cb cb, void* p_user_data );
 
+/*
+ * As for media_library_get_artist_albums, the following getters invoke the
+ * callback with a NULL list when the requested entity doesn't exist.
+ */
 void
 media_library_get_album_songs(media_library* p_ml, int64_t i_album_id, media_library_list_cb cb, void* p_user_data);
 
@@ -118,6 +206,64 @@ media_library_register_item_updated(media_library* ml, media_library_item_update
 void
 media_library_unregister_item_updated(media_library* ml, media_library_item_updated_cb cb, void* p_data );
 
+void
+media_library_register_items_updated(media_library* ml, media_library_items_updated_cb cb, void* p_data );
+
+void
+media_library_unregister_items_updated(media_library* ml, media_library_items_updated_cb cb, void* p_data );
+
+void
+media_library_register_items_deleted(media_library* ml, media_library_items_deleted_cb cb, void* p_data );
+
+void
+media_library_unregister_items_deleted(media_library* ml, media_library_items_deleted_cb cb, void* p_data );
+
+/*
+ * Kinds of library items to search for, to be combined as a mask
+ */
+#define ML_SEARCH_MEDIA     (1u << LIBRARY_ITEM_MEDIA)
+#define ML_SEARCH_ALBUM     (1u << LIBRARY_ITEM_ALBUM)
+#define ML_SEARCH_ARTIST    (1u << LIBRARY_ITEM_ARTIST)
+#define ML_SEARCH_GENRE     (1u << LIBRARY_ITEM_GENRE)
+#define ML_SEARCH_ALL       (ML_SEARCH_MEDIA | ML_SEARCH_ALBUM | ML_SEARCH_ARTIST | ML_SEARCH_GENRE)
+
+/*
+ * Searches the titles, artists, albums, genres and file names of the library.
+ * The callback receives a list of library items (media_item, album_item...)
+ * ranked by relevance, or NULL if nothing matched.
+ * The pending searches issued with the same p_user_data are cancelled, since
+ * an as-you-type search only cares about the latest one. The other queries
+ * issued with p_user_data are left alone.
+ */
+void
+media_library_search( media_library* p_ml, const char* psz_query, unsigned int i_kinds, media_library_list_cb cb, void* p_user_data );
+
+/*
+ * Cancels all the pending queries issued with p_user_data as their user data.
+ * Results that weren't delivered yet are dropped, and the callback won't be
+ * invoked for them anymore.
+ */
+void
+media_library_cancel_queries( media_library* p_ml, void* p_user_data );
+
+/*
+ * Sets the priority of the queries issued with p_user_data as their user data
+ * from now on. It is kept until it is set back to ML_QUERY_PRIORITY_VISIBLE.
+ */
+void
+media_library_set_query_priority( media_library* p_ml, void* p_user_data, media_library_query_priority i_priority );
+
+/*
+ * Sets the order in which the getters issued with p_user_data as their user
+ * data deliver their results. When pf_sections is provided and the key is a
+ * textual one (title, artist or album), the section headers are computed
+ * along with the sorting.
+ * Setting ML_SORT_DEFAULT and a NULL pf_sections reverts to the default order.
+ * Needs to be called from the main loop.
+ */
+void
+media_library_set_sort( media_library* p_ml, void* p_user_data, media_library_sort_key i_key, bool b_descending, media_library_sections_cb pf_sections );
+
 void
 media_library_register_progress_cb( media_library* ml, media_library_scan_progress_cb pf_progress, void* p_data );
 
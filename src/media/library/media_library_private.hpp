@@ -24,7 +24,11 @@
  * compatibility with the Store
  *****************************************************************************/
 
+#include <functional>
+#include <map>
 #include <mutex>
+#include <string>
+#include <unordered_map>
 
 #include "IAlbum.h"
 #include "IMedia.h"
@@ -35,11 +39,115 @@
 #include "media/artist_item.h"
 #include "media/genre_item.h"
 #include "media/playlist_item.h"
+#include "query_executor.hpp"
+#include "search_index.hpp"
+
+struct library_item
+{
+    LIBRARY_ITEM_COMMON
+};
+
+/*
+ * Per entity counters, fetched for all the library at once
+ */
+struct LibraryStatistics
+{
+    struct Counts
+    {
+        Counts() : nbAlbums( 0 ), nbTracks( 0 ), duration( 0 ) {}
+        uint32_t nbAlbums;
+        uint32_t nbTracks;
+        int64_t duration;
+    };
+
+    LibraryStatistics() : valid( false ) {}
+    std::unordered_map<int64_t, Counts> artists;
+    std::unordered_map<int64_t, Counts> albums;
+    std::unordered_map<int64_t, Counts> genres;
+    // false if the statistics couldn't be fetched
+    bool valid;
+};
+
+bool fetchLibraryStatistics( const std::string& dbPath, LibraryStatistics& stats );
+
+/*
+ * Sorting options of a query owner
+ */
+struct SortOptions
+{
+    SortOptions() : key( ML_SORT_DEFAULT ), descending( false ), sectionsCb( nullptr ) {}
+    media_library_sort_key key;
+    bool descending;
+    media_library_sections_cb sectionsCb;
+};
+
+struct SortEntry
+{
+    int64_t id;
+    // First letter bucket, empty when the key isn't a textual one
+    std::string label;
+};
+
+/*
+ * Fetches the IDs of the entities of the given type, in the requested order.
+ * Only the entities listed in ids are fetched, unless it is empty.
+ * Returns false if the key doesn't apply to this type, or if the database
+ * couldn't be queried.
+ */
+bool fetchSortOrder( const std::string& dbPath, library_item_type type, const SortOptions& options,
+                     const std::vector<int64_t>& ids, std::vector<SortEntry>& order );
 
 media_item* fileToMediaItem( MediaPtr file );
-album_item* albumToAlbumItem( AlbumPtr album );
-artist_item* artistToArtistItem( ArtistPtr album );
-genre_item* genreToGenreItem( GenrePtr genre );
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+/*
+ * Converts media by windows: prepare() fetches the data related to all the
+ * media of the window at once, then each media of that window can be
+ * converted without any additional database round-trip.
+ * Media that weren't part of the prepared window are converted using
+ * fileToMediaItem
+ */
+class MediaConvertor
+{
+public:
+    struct MediaData
+    {
+        MediaData() : hasVideoTrack( false ), width( 0 ), height( 0 )
+            , hasAlbumTrack( false ), trackNumber( 0 ), hasAlbum( false )
+            , hasArtist( false ) {}
+        std::string mrl;
+        bool hasVideoTrack;
+        unsigned int width;
+        unsigned int height;
+        bool hasAlbumTrack;
+        unsigned int trackNumber;
+        bool hasAlbum;
+        std::string albumTitle;
+        std::string albumArtwork;
+        bool hasArtist;
+        std::string artistName;
+    };
+
+    explicit MediaConvertor( const std::string& dbPath );
+    void prepare( const std::vector<MediaPtr>& media, size_t first, size_t last );
+    media_item* operator()( MediaPtr media );
+    // Returns the data prepared for this media, or nullptr
+    const MediaData* data( int64_t mediaId ) const;
+
+private:
+    bool open();
+    bool run( const std::string& req, std::function<void(sqlite3_stmt*)> rowCb );
+
+private:
+    std::string m_dbPath;
+    std::shared_ptr<sqlite3> m_db;
+    std::unordered_map<int64_t, MediaData> m_data;
+};
+album_item* albumToAlbumItem( AlbumPtr album, const LibraryStatistics* stats );
+artist_item* artistToArtistItem( ArtistPtr album, const LibraryStatistics* stats );
+genre_item* genreToGenreItem( GenrePtr genre, const LibraryStatistics* stats );
 playlist_item* playlistToPlaylistItem( PlaylistPtr playlist );
 
 class TizenLogger : public ILogger
@@ -69,7 +177,7 @@ struct media_library : public IMediaLibraryCb
 {
 public:
     media_library();
-    virtual ~media_library() = default;
+    virtual ~media_library();
 
     // IMediaLibraryCb
     virtual void onMediaAdded( std::vector<MediaPtr> media ) override;
@@ -101,6 +209,12 @@ public:
     void registerOnItemUpdated(media_library_item_updated_cb cb, void* userData);
     void unregisterOnItemUpdated(media_library_item_updated_cb cb, void* userData);
 
+    void registerOnItemsUpdated(media_library_items_updated_cb cb, void* userData);
+    void unregisterOnItemsUpdated(media_library_items_updated_cb cb, void* userData);
+
+    void registerOnItemsDeleted(media_library_items_deleted_cb cb, void* userData);
+    void unregisterOnItemsDeleted(media_library_items_deleted_cb cb, void* userData);
+
     void registerProgressCb( media_library_scan_progress_cb pf_progress, void* p_data );
 
 public:
@@ -109,20 +223,40 @@ public:
     // I'll make up my mind someday, I promise.
     std::unique_ptr<TizenLogger> logger;
     std::shared_ptr<IMediaLibrary> ml;
+    std::shared_ptr<QueryExecutor> executor;
+    // Database read by the direct queries, empty if its version isn't supported
+    std::string dbPath;
+    SearchIndex searchIndex;
+    // Per query owner. Only accessed from the main loop
+    std::unordered_map<void*, SortOptions> sortOptions;
+    // A new search only cancels the previous search of its caller, so the
+    // searches have their own query owner: the address of the caller's entry.
+    // Only accessed from the main loop
+    std::unordered_map<void*, char> searchOwners;
 
 private:
-    void sendFileUpdate( MediaPtr item, bool added );
+    void sendFileUpdates( const std::vector<MediaPtr>& media, bool added );
+    void flushFileUpdates();
+    void dispatchFileUpdates( Eina_List* items, bool added );
+    void sendDeletions( library_item_type type, const std::vector<int64_t>& ids );
+    void scheduleFlush();
+
+public:
+    // Needs to be called from the main loop
+    void scheduleSearchIndexRebuild();
+    // Returns false if the token got cancelled before the index was filled
+    bool fillSearchIndex( SearchIndex& index, const QueryExecutor::Token& token );
+    static void indexMediaItem( SearchIndex& index, const media_item* item );
+    static void indexMedia( SearchIndex& index, MediaPtr media, const MediaConvertor::MediaData* data );
 
 private:
     struct FileUpdateCallbackCtx
     {
-        FileUpdateCallbackCtx(media_library* _ml, media_item* _item, bool _added)
-            : ml(_ml), wml(ml->ml), item(_item, media_item_destroy), added(_added) {}
+        FileUpdateCallbackCtx(media_library* _ml)
+            : ml(_ml), wml(ml->ml) {}
         media_library* ml;
-        std::weak_ptr<IMediaLibrary> wml;
-        std::unique_ptr<media_item, void(*)(media_item*)> item;
         // Used to monitor media_library's lifetime.
-        bool added;
+        std::weak_ptr<IMediaLibrary> wml;
     };
 
     struct ProgressUpdateCallbackCtx
@@ -141,6 +275,15 @@ private:
 private:
     std::vector<std::pair<media_library_file_list_changed_cb, void*>> m_onChangeCb;
     std::vector<std::pair<media_library_item_updated_cb, void*>> m_onItemUpdatedCb;
+    std::vector<std::pair<media_library_items_updated_cb, void*>> m_onItemsUpdatedCb;
+    std::vector<std::pair<media_library_items_deleted_cb, void*>> m_onItemsDeletedCb;
+
+    // Converted items waiting to be sent to the main loop, protected by m_updatesLock
+    std::mutex m_updatesLock;
+    Eina_List* m_pendingAdded;
+    Eina_List* m_pendingUpdated;
+    std::map<library_item_type, std::vector<int64_t>> m_pendingDeleted;
+    bool m_updatesScheduled;
     media_library_scan_progress_cb m_progressCb;
     void* m_progressData;
 };
@@ -0,0 +1,158 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+#include "common.h"
+
+#include <Ecore.h>
+
+#include "query_executor.hpp"
+
+QueryExecutor::QueryExecutor( unsigned int nbWorkers )
+    : m_nbWorkers( nbWorkers > 0 ? nbWorkers : 1 )
+    , m_nbRunning( 0 )
+    , m_shutdown( false )
+{
+}
+
+void
+QueryExecutor::submit( void* owner, Task task )
+{
+    std::lock_guard<std::mutex> lock( m_lock );
+    if ( m_shutdown == true )
+        return;
+    auto& state = m_owners[owner];
+    if ( state == nullptr )
+        state = std::make_shared<OwnerState>();
+    m_queues[state->priority].emplace_back( Token( state ), std::move( task ) );
+    if ( m_nbRunning >= m_nbWorkers )
+        return;
+    ++m_nbRunning;
+    startWorker();
+}
+
+void
+QueryExecutor::cancel( void* owner )
+{
+    std::lock_guard<std::mutex> lock( m_lock );
+    auto it = m_owners.find( owner );
+    if ( it == end( m_owners ) )
+        return;
+    // Invalidate all the tokens handed out so far. Queued queries will be
+    // skipped, running ones will stop at their next check.
+    ++it->second->generation;
+    // A fresh state would be the same, unless a priority was set
+    if ( it->second->priority == ML_QUERY_PRIORITY_VISIBLE )
+        m_owners.erase( it );
+}
+
+void
+QueryExecutor::setPriority( void* owner, media_library_query_priority priority )
+{
+    std::lock_guard<std::mutex> lock( m_lock );
+    auto& state = m_owners[owner];
+    if ( state == nullptr )
+        state = std::make_shared<OwnerState>();
+    state->priority = priority;
+}
+
+void
+QueryExecutor::shutdown()
+{
+    std::unique_lock<std::mutex> lock( m_lock );
+    m_shutdown = true;
+    for ( auto& owner : m_owners )
+        ++owner.second->generation;
+    m_owners.clear();
+    for ( auto& queue : m_queues )
+        queue.clear();
+    // Running queries check their token regularly, so they return quickly
+    m_idle.wait( lock, [this]() { return m_nbRunning == 0; } );
+}
+
+QueryExecutor::Token
+QueryExecutor::token( void* owner )
+{
+    std::lock_guard<std::mutex> lock( m_lock );
+    if ( m_shutdown == true )
+        return Token();
+    auto& state = m_owners[owner];
+    if ( state == nullptr )
+        state = std::make_shared<OwnerState>();
+    return Token( state );
+}
+
+/* Needs to be called with m_lock held */
+void
+QueryExecutor::startWorker()
+{
+    // The worker keeps the executor alive until it's done
+    auto self = new std::shared_ptr<QueryExecutor>( shared_from_this() );
+    ecore_thread_run( [](void* data, Ecore_Thread* ) {
+        auto self = reinterpret_cast<std::shared_ptr<QueryExecutor>*>( data );
+        (*self)->run();
+    }, [](void* data, Ecore_Thread* ) {
+        delete reinterpret_cast<std::shared_ptr<QueryExecutor>*>( data );
+    }, [](void* data, Ecore_Thread* ) {
+        // The worker never got a chance to run, release its slot
+        std::unique_ptr<std::shared_ptr<QueryExecutor>> self(
+                    reinterpret_cast<std::shared_ptr<QueryExecutor>*>( data ) );
+        std::lock_guard<std::mutex> lock( (*self)->m_lock );
+        if ( --(*self)->m_nbRunning == 0 )
+            (*self)->m_idle.notify_all();
+    }, self );
+}
+
+void
+QueryExecutor::run()
+{
+    Task task;
+    Token token;
+    while ( popQuery( task, token ) == true )
+        task( token );
+}
+
+bool
+QueryExecutor::popQuery( Task& task, Token& token )
+{
+    std::lock_guard<std::mutex> lock( m_lock );
+    for ( auto& queue : m_queues )
+    {
+        while ( queue.empty() == false )
+        {
+            auto query = std::move( queue.front() );
+            queue.pop_front();
+            if ( query.token.isCancelled() == true )
+                continue;
+            task = std::move( query.task );
+            token = std::move( query.token );
+            return true;
+        }
+    }
+    // Nothing left to do, this worker is about to exit
+    if ( --m_nbRunning == 0 )
+        m_idle.notify_all();
+    return false;
+}
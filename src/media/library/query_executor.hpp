@@ -0,0 +1,117 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+#ifndef QUERY_EXECUTOR_HPP_
+# define QUERY_EXECUTOR_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "media_library.hpp"
+
+/*
+ * Runs media library queries on a bounded set of ecore worker threads.
+ *
+ * Queries are grouped by owner (the user data provided to the getters, ie.
+ * the requesting controller). Each owner has a generation counter, which is
+ * bumped when its pending queries get cancelled. A query captures the
+ * generation it was submitted in, and is considered stale as soon as it
+ * doesn't match anymore, so its results can be dropped as early as possible.
+ */
+class QueryExecutor : public std::enable_shared_from_this<QueryExecutor>
+{
+private:
+    struct OwnerState
+    {
+        OwnerState() : generation( 0 ), priority( ML_QUERY_PRIORITY_VISIBLE ) {}
+        std::atomic<unsigned int> generation;
+        // Protected by the executor lock
+        media_library_query_priority priority;
+    };
+
+public:
+    class Token
+    {
+    public:
+        Token() : m_generation( 0 ) {}
+        Token( std::shared_ptr<OwnerState> state )
+            : m_state( std::move( state ) ), m_generation( m_state->generation ) {}
+        // Can be called from any thread
+        bool isCancelled() const
+        {
+            return m_state == nullptr || m_state->generation != m_generation;
+        }
+
+    private:
+        std::shared_ptr<OwnerState> m_state;
+        unsigned int m_generation;
+    };
+
+    using Task = std::function<void(const Token&)>;
+
+public:
+    explicit QueryExecutor( unsigned int nbWorkers );
+
+    // The following functions are meant to be called from the main loop
+    void submit( void* owner, Task task );
+    void cancel( void* owner );
+    void setPriority( void* owner, media_library_query_priority priority );
+    // Cancels the queries of all the owners, and waits for the running ones
+    // to return. Nothing can be submitted afterward.
+    void shutdown();
+    // Returns a token that gets cancelled along with the owner's queries.
+    // Can be called from any thread
+    Token token( void* owner );
+
+private:
+    void startWorker();
+    void run();
+    bool popQuery( Task& task, Token& token );
+
+private:
+    struct Query
+    {
+        Query( Token t, Task f ) : token( std::move( t ) ), task( std::move( f ) ) {}
+        Token token;
+        Task task;
+    };
+
+    const unsigned int m_nbWorkers;
+    std::mutex m_lock;
+    // Signaled when the last worker exits
+    std::condition_variable m_idle;
+    unsigned int m_nbRunning;
+    bool m_shutdown;
+    std::deque<Query> m_queues[ML_QUERY_PRIORITY_COUNT];
+    std::unordered_map<void*, std::shared_ptr<OwnerState>> m_owners;
+};
+
+#endif // QUERY_EXECUTOR_HPP_
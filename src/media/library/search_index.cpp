@@ -0,0 +1,306 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+#include "common.h"
+
+#include <algorithm>
+#include <cctype>
+
+#include "search_index.hpp"
+
+static bool
+is_separator( char c )
+{
+    // Non ASCII (UTF-8) bytes are considered part of words
+    auto u = static_cast<unsigned char>( c );
+    return u < 0x80 && isalnum( u ) == 0;
+}
+
+static std::string
+normalize( const std::string& str )
+{
+    std::string res;
+    res.reserve( str.size() );
+    for ( auto c : str )
+    {
+        auto u = static_cast<unsigned char>( c );
+        if ( u < 0x80 )
+            c = static_cast<char>( tolower( u ) );
+        res += c;
+    }
+    return res;
+}
+
+static std::vector<std::string>
+split_words( const std::string& str )
+{
+    std::vector<std::string> words;
+    std::string word;
+    for ( auto c : str )
+    {
+        if ( is_separator( c ) == true )
+        {
+            if ( word.empty() == false )
+                words.push_back( std::move( word ) );
+            word.clear();
+        }
+        else
+            word += c;
+    }
+    if ( word.empty() == false )
+        words.push_back( std::move( word ) );
+    return words;
+}
+
+/*
+ * Trigrams are packed in the 24 lower bits. Word prefixes use the upper byte
+ * as a marker, so they don't collide with trigrams
+ */
+static uint32_t
+trigram_key( const char* p )
+{
+    return static_cast<unsigned char>( p[0] ) << 16 |
+           static_cast<unsigned char>( p[1] ) << 8 |
+           static_cast<unsigned char>( p[2] );
+}
+
+static uint32_t
+prefix_key( const char* p, size_t len )
+{
+    if ( len == 1 )
+        return 0x01000000 | static_cast<unsigned char>( p[0] );
+    return 0x02000000 | static_cast<unsigned char>( p[0] ) << 8 | static_cast<unsigned char>( p[1] );
+}
+
+/* Returns true if word is found at the beginning of a word in text, from pos */
+static bool
+is_word_start( const std::string& text, size_t pos )
+{
+    return pos == 0 || is_separator( text[pos - 1] ) == true;
+}
+
+SearchIndex::SearchIndex()
+    : m_built( false )
+    , m_building( false )
+{
+}
+
+void
+SearchIndex::add( Data& data, library_item_type type, int64_t id, const std::vector<std::string>& fields )
+{
+    remove( data, type, id );
+
+    Entry entry;
+    entry.type = type;
+    entry.id = id;
+    entry.alive = true;
+    for ( const auto& f : fields )
+    {
+        if ( entry.text.empty() == false )
+            entry.text += '\n';
+        entry.text += normalize( f );
+        if ( &f == &fields.front() )
+            entry.titleLength = entry.text.size();
+    }
+    if ( fields.empty() == true )
+        entry.titleLength = 0;
+
+    auto idx = static_cast<uint32_t>( data.entries.size() );
+    std::vector<uint32_t> keys;
+    const auto& text = entry.text;
+    for ( size_t i = 0; i + 2 < text.size(); ++i )
+    {
+        if ( text[i] == '\n' || text[i + 1] == '\n' || text[i + 2] == '\n' )
+            continue;
+        keys.push_back( trigram_key( &text[i] ) );
+    }
+    for ( size_t i = 0; i < text.size(); ++i )
+    {
+        if ( is_separator( text[i] ) == true || is_word_start( text, i ) == false )
+            continue;
+        keys.push_back( prefix_key( &text[i], 1 ) );
+        if ( i + 1 < text.size() && is_separator( text[i + 1] ) == false )
+            keys.push_back( prefix_key( &text[i], 2 ) );
+    }
+    std::sort( begin( keys ), end( keys ) );
+    keys.erase( std::unique( begin( keys ), end( keys ) ), end( keys ) );
+    // Entries are only ever appended, so the posting lists stay sorted
+    for ( auto k : keys )
+        data.grams[k].push_back( idx );
+
+    data.ids[std::make_pair( static_cast<int>( type ), id )] = idx;
+    data.entries.push_back( std::move( entry ) );
+}
+
+void
+SearchIndex::remove( Data& data, library_item_type type, int64_t id )
+{
+    auto it = data.ids.find( std::make_pair( static_cast<int>( type ), id ) );
+    if ( it == end( data.ids ) )
+        return;
+    // Dead entries are skipped when searching, and dropped on the next rebuild
+    data.entries[it->second].alive = false;
+    data.ids.erase( it );
+}
+
+void
+SearchIndex::add( library_item_type type, int64_t id, const std::vector<std::string>& fields )
+{
+    std::lock_guard<std::mutex> lock( m_lock );
+    add( m_data, type, id, fields );
+    if ( m_building == true )
+        m_replay.emplace_back( [type, id, fields]( Data& data ) { add( data, type, id, fields ); } );
+}
+
+void
+SearchIndex::remove( library_item_type type, int64_t id )
+{
+    std::lock_guard<std::mutex> lock( m_lock );
+    remove( m_data, type, id );
+    if ( m_building == true )
+        m_replay.emplace_back( [type, id]( Data& data ) { remove( data, type, id ); } );
+}
+
+void
+SearchIndex::rebuild( std::function<bool(SearchIndex&)> fill, bool onlyIfNeeded )
+{
+    // Waits for a rebuild that would already be in progress
+    std::lock_guard<std::mutex> buildLock( m_buildLock );
+    {
+        std::lock_guard<std::mutex> lock( m_lock );
+        if ( onlyIfNeeded == true && m_built == true )
+            return;
+        m_building = true;
+        m_replay.clear();
+    }
+    // Fill a separate index, so searches keep using the current one meanwhile
+    SearchIndex index;
+    bool completed = fill( index );
+
+    std::lock_guard<std::mutex> lock( m_lock );
+    if ( completed == false )
+    {
+        m_replay.clear();
+        m_building = false;
+        return;
+    }
+    for ( auto& op : m_replay )
+        op( index.m_data );
+    m_replay.clear();
+    std::swap( m_data, index.m_data );
+    m_building = false;
+    m_built = true;
+}
+
+std::vector<SearchIndex::Result>
+SearchIndex::search( const std::string& query, unsigned int kinds, size_t maxResults ) const
+{
+    std::vector<Result> results;
+    auto words = split_words( normalize( query ) );
+    if ( words.empty() == true )
+        return results;
+
+    std::lock_guard<std::mutex> lock( m_lock );
+
+    // Gather the posting lists of each word, and start from the smallest one
+    std::vector<const std::vector<uint32_t>*> postings;
+    for ( const auto& w : words )
+    {
+        if ( w.size() < 3 )
+        {
+            auto it = m_data.grams.find( prefix_key( w.c_str(), w.size() ) );
+            if ( it == end( m_data.grams ) )
+                return results;
+            postings.push_back( &it->second );
+            continue;
+        }
+        for ( size_t i = 0; i + 2 < w.size(); ++i )
+        {
+            auto it = m_data.grams.find( trigram_key( &w[i] ) );
+            if ( it == end( m_data.grams ) )
+                return results;
+            postings.push_back( &it->second );
+        }
+    }
+    std::sort( begin( postings ), end( postings ),
+               []( const std::vector<uint32_t>* l, const std::vector<uint32_t>* r ) {
+        return l->size() < r->size();
+    });
+    std::vector<uint32_t> candidates = *postings[0];
+    std::vector<uint32_t> tmp;
+    for ( size_t i = 1; i < postings.size() && candidates.empty() == false; ++i )
+    {
+        tmp.clear();
+        std::set_intersection( begin( candidates ), end( candidates ),
+                               begin( *postings[i] ), end( *postings[i] ),
+                               std::back_inserter( tmp ) );
+        std::swap( candidates, tmp );
+    }
+
+    // Trigrams may yield false positives: check each candidate, and rank it
+    auto normalizedQuery = normalize( query );
+    for ( auto idx : candidates )
+    {
+        const auto& e = m_data.entries[idx];
+        if ( e.alive == false || ( kinds & ( 1u << e.type ) ) == 0 )
+            continue;
+        int score = 0;
+        bool match = true;
+        for ( const auto& w : words )
+        {
+            int best = -1;
+            for ( auto pos = e.text.find( w ); pos != std::string::npos; pos = e.text.find( w, pos + 1 ) )
+            {
+                bool inTitle = pos < e.titleLength;
+                bool wordStart = is_word_start( e.text, pos );
+                if ( w.size() < 3 && wordStart == false )
+                    continue;
+                int s = ( inTitle ? 40 : 10 ) + ( wordStart ? 20 : 0 ) + ( pos == 0 ? 40 : 0 );
+                best = std::max( best, s );
+            }
+            if ( best < 0 )
+            {
+                match = false;
+                break;
+            }
+            score += best;
+        }
+        if ( match == false )
+            continue;
+        if ( e.text.compare( 0, e.titleLength, normalizedQuery ) == 0 )
+            score += 200;
+        // Favor short titles, which the query covers better
+        score -= static_cast<int>( std::min<size_t>( e.titleLength, 100 ) ) / 10;
+        results.push_back( Result{ e.type, e.id, score } );
+    }
+
+    auto last = results.size() > maxResults ? begin( results ) + maxResults : end( results );
+    std::partial_sort( begin( results ), last, end( results ), []( const Result& l, const Result& r ) {
+        return l.score > r.score;
+    });
+    results.erase( last, end( results ) );
+    return results;
+}
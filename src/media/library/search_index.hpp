@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+#ifndef SEARCH_INDEX_HPP_
+# define SEARCH_INDEX_HPP_
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "library_item.h"
+
+/*
+ * In memory full text index over the library items names.
+ *
+ * Each item is indexed by the trigrams of its normalized fields, and by the
+ * 1 and 2 characters prefixes of each of its words. Query words of 3 or more
+ * characters match anywhere, shorter ones only match the beginning of a word,
+ * which is what one expects while typing.
+ * All the functions are thread safe.
+ */
+class SearchIndex
+{
+public:
+    struct Result
+    {
+        library_item_type type;
+        int64_t id;
+        int score;
+    };
+
+public:
+    SearchIndex();
+
+    // Fields are ordered by relevance, the first one being the item title/name
+    void add( library_item_type type, int64_t id, const std::vector<std::string>& fields );
+    void remove( library_item_type type, int64_t id );
+    // kinds is a mask of (1 << library_item_type)
+    std::vector<Result> search( const std::string& query, unsigned int kinds, size_t maxResults ) const;
+
+    // Builds a new index from scratch, using the provided function to fill it.
+    // Modifications happening meanwhile are replayed on the new index.
+    // The fill function returns false if it was interrupted, in which case
+    // the current index is kept.
+    // When onlyIfNeeded is true, nothing is done if the index was already built
+    void rebuild( std::function<bool(SearchIndex&)> fill, bool onlyIfNeeded );
+
+private:
+    struct Entry
+    {
+        library_item_type type;
+        int64_t id;
+        // Normalized fields, separated by '\n'
+        std::string text;
+        size_t titleLength;
+        bool alive;
+    };
+
+    struct Data
+    {
+        std::vector<Entry> entries;
+        std::unordered_map<uint32_t, std::vector<uint32_t>> grams;
+        std::map<std::pair<int, int64_t>, uint32_t> ids;
+    };
+
+    static void add( Data& data, library_item_type type, int64_t id, const std::vector<std::string>& fields );
+    static void remove( Data& data, library_item_type type, int64_t id );
+
+private:
+    mutable std::mutex m_lock;
+    Data m_data;
+    bool m_built;
+    bool m_building;
+    // Modifications to replay once the index being built replaces the current one
+    std::vector<std::function<void(Data&)>> m_replay;
+    // Only one rebuild at a time
+    std::mutex m_buildLock;
+};
+
+#endif // SEARCH_INDEX_HPP_
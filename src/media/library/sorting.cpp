@@ -0,0 +1,230 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+#include "common.h"
+
+#include <cctype>
+#include <sqlite3.h>
+
+#include "media_library_private.hpp"
+
+/*
+ * The medialibrary doesn't sort its results, so the ordering is delegated to
+ * a read-only query on its database, which returns the IDs in the requested
+ * order. Sorting a list on the UI thread is then never needed.
+ */
+struct SortRequest
+{
+    // Selects the entity ID and, for textual keys, the sorted text
+    const char* select;
+    // The entity ID column, used to only fetch the order of the results
+    const char* id;
+    const char* orderBy;
+    // Secondary ordering, always ascending. Can be null
+    const char* tieBreak;
+    // Can be null
+    const char* groupBy;
+};
+
+#define ALBUM_TRACKS "SELECT alb.id_album, NULL FROM Album alb" \
+    " LEFT JOIN AlbumTrack t ON t.album_id = alb.id_album" \
+    " LEFT JOIN Media m ON m.id_media = t.media_id"
+
+static bool
+sortRequest( library_item_type type, media_library_sort_key key, SortRequest& req )
+{
+    req = SortRequest{ nullptr, nullptr, nullptr, nullptr, nullptr };
+    switch ( type )
+    {
+    case LIBRARY_ITEM_MEDIA:
+        switch ( key )
+        {
+        case ML_SORT_TITLE:
+            req = { "SELECT id_media, title FROM Media", "id_media", "title COLLATE NOCASE", nullptr, nullptr };
+            break;
+        case ML_SORT_ARTIST:
+            req = { "SELECT m.id_media, art.name FROM Media m"
+                    " LEFT JOIN AlbumTrack t ON t.media_id = m.id_media"
+                    " LEFT JOIN Artist art ON art.id_artist = t.artist_id",
+                    "m.id_media", "art.name COLLATE NOCASE", "m.title COLLATE NOCASE", nullptr };
+            break;
+        case ML_SORT_ALBUM:
+            req = { "SELECT m.id_media, alb.title FROM Media m"
+                    " LEFT JOIN AlbumTrack t ON t.media_id = m.id_media"
+                    " LEFT JOIN Album alb ON alb.id_album = t.album_id",
+                    "m.id_media", "alb.title COLLATE NOCASE", "t.track_number", nullptr };
+            break;
+        case ML_SORT_DURATION:
+            req = { "SELECT id_media, NULL FROM Media", "id_media", "duration", nullptr, nullptr };
+            break;
+        case ML_SORT_INSERTION_DATE:
+            req = { "SELECT id_media, NULL FROM Media", "id_media", "insertion_date", nullptr, nullptr };
+            break;
+        case ML_SORT_TRACK_NUMBER:
+            req = { "SELECT m.id_media, NULL FROM Media m"
+                    " LEFT JOIN AlbumTrack t ON t.media_id = m.id_media",
+                    "m.id_media", "t.track_number", "m.title COLLATE NOCASE", nullptr };
+            break;
+        default:
+            break;
+        }
+        break;
+    case LIBRARY_ITEM_ALBUM:
+        switch ( key )
+        {
+        case ML_SORT_TITLE:
+        case ML_SORT_ALBUM:
+            req = { "SELECT id_album, title FROM Album", "id_album", "title COLLATE NOCASE", nullptr, nullptr };
+            break;
+        case ML_SORT_ARTIST:
+            req = { "SELECT alb.id_album, art.name FROM Album alb"
+                    " LEFT JOIN Artist art ON art.id_artist = alb.artist_id",
+                    "alb.id_album", "art.name COLLATE NOCASE", "alb.title COLLATE NOCASE", nullptr };
+            break;
+        case ML_SORT_DURATION:
+            req = { ALBUM_TRACKS, "alb.id_album", "SUM(m.duration)", nullptr, "alb.id_album" };
+            break;
+        case ML_SORT_INSERTION_DATE:
+            req = { ALBUM_TRACKS, "alb.id_album", "MAX(m.insertion_date)", nullptr, "alb.id_album" };
+            break;
+        default:
+            break;
+        }
+        break;
+    case LIBRARY_ITEM_ARTIST:
+        if ( key == ML_SORT_TITLE || key == ML_SORT_ARTIST )
+            req = { "SELECT id_artist, name FROM Artist", "id_artist", "name COLLATE NOCASE", nullptr, nullptr };
+        break;
+    case LIBRARY_ITEM_GENRE:
+        if ( key == ML_SORT_TITLE )
+            req = { "SELECT id_genre, name FROM Genre", "id_genre", "name COLLATE NOCASE", nullptr, nullptr };
+        break;
+    case LIBRARY_ITEM_PLAYLIST:
+        if ( key == ML_SORT_TITLE )
+            req = { "SELECT id_playlist, name FROM Playlist", "id_playlist", "name COLLATE NOCASE", nullptr, nullptr };
+        else if ( key == ML_SORT_INSERTION_DATE )
+            req = { "SELECT id_playlist, NULL FROM Playlist", "id_playlist", "creation_date", nullptr, nullptr };
+        break;
+    }
+    return req.select != nullptr;
+}
+
+/*
+ * ASCII letters are bucketed case insensitively, other ASCII characters
+ * all go to '#', and non ASCII ones get their own bucket.
+ */
+static std::string
+sectionLabel( const unsigned char* text )
+{
+    if ( text == nullptr || *text == 0 )
+        return "#";
+    if ( *text < 0x80 )
+    {
+        if ( isalpha( *text ) == 0 )
+            return "#";
+        return std::string( 1, static_cast<char>( toupper( *text ) ) );
+    }
+    // Keep the whole UTF-8 sequence
+    size_t len = 1;
+    while ( len < 4 && ( text[len] & 0xC0 ) == 0x80 )
+        ++len;
+    return std::string( reinterpret_cast<const char*>( text ), len );
+}
+
+bool
+fetchSortOrder( const std::string& dbPath, library_item_type type, const SortOptions& options,
+                const std::vector<int64_t>& ids, std::vector<SortEntry>& order )
+{
+    SortRequest req;
+    bool withLabels = options.sectionsCb != nullptr && ( options.key == ML_SORT_TITLE ||
+            options.key == ML_SORT_ARTIST || options.key == ML_SORT_ALBUM );
+    if ( dbPath.empty() == true || sortRequest( type, options.key, req ) == false )
+        return false;
+    std::string request = req.select;
+    if ( ids.empty() == false )
+    {
+        request += " WHERE ";
+        request += req.id;
+        request += " IN (";
+        for ( size_t i = 0; i < ids.size(); ++i )
+        {
+            if ( i > 0 )
+                request += ',';
+            request += std::to_string( ids[i] );
+        }
+        request += ')';
+    }
+    if ( req.groupBy != nullptr )
+    {
+        request += " GROUP BY ";
+        request += req.groupBy;
+    }
+    request += " ORDER BY ";
+    request += req.orderBy;
+    request += options.descending == true ? " DESC" : " ASC";
+    if ( req.tieBreak != nullptr )
+    {
+        request += ", ";
+        request += req.tieBreak;
+    }
+
+    sqlite3* db;
+    auto rc = sqlite3_open_v2( dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr );
+    if ( rc != SQLITE_OK )
+    {
+        LOGE( "Failed to open %s: %s", dbPath.c_str(), sqlite3_errmsg( db ) );
+        sqlite3_close( db );
+        return false;
+    }
+    // The medialibrary may be writing at the same time
+    sqlite3_busy_timeout( db, 500 );
+    sqlite3_stmt* stmt;
+    rc = sqlite3_prepare_v2( db, request.c_str(), -1, &stmt, nullptr );
+    if ( rc != SQLITE_OK )
+    {
+        // Most likely a medialibrary schema change, the results will be
+        // delivered unsorted
+        LOGE( "Failed to prepare sort request: %s", sqlite3_errmsg( db ) );
+        sqlite3_close( db );
+        return false;
+    }
+    while ( ( rc = sqlite3_step( stmt ) ) == SQLITE_ROW )
+    {
+        SortEntry entry;
+        entry.id = sqlite3_column_int64( stmt, 0 );
+        if ( withLabels == true )
+            entry.label = sectionLabel( sqlite3_column_text( stmt, 1 ) );
+        order.push_back( std::move( entry ) );
+    }
+    if ( rc != SQLITE_DONE )
+    {
+        LOGE( "Failed to fetch sort order: %s", sqlite3_errmsg( db ) );
+        order.clear();
+    }
+    sqlite3_finalize( stmt );
+    sqlite3_close( db );
+    return rc == SQLITE_DONE;
+}
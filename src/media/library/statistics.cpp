@@ -0,0 +1,117 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * Authors: Hugo Beauzée-Luyssen <hugo@beauzee.fr>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+#include "common.h"
+
+#include <sqlite3.h>
+
+#include "media_library_private.hpp"
+
+/*
+ * The medialibrary API only allows fetching the albums/tracks of an entity
+ * one entity at a time. Listing N artists would then require N extra queries,
+ * so we aggregate all the counters with a single read-only query on the
+ * medialibrary database instead.
+ * Kinds: 0 = albums of an artist, 1 = album, 2 = genre, 3 = tracks of an artist
+ * Like IArtist::albums(), an artist has the albums it is related to, not only
+ * the ones it is the album artist of.
+ */
+#define STATS_DURATION "SUM(CASE WHEN m.duration > 0 THEN m.duration ELSE 0 END)"
+
+static const char* const statsRequest =
+    "SELECT 0, aar.artist_id, COUNT(DISTINCT aar.album_id), 0, 0"
+    " FROM AlbumArtistRelation aar GROUP BY aar.artist_id"
+    " UNION ALL "
+    "SELECT 1, t.album_id, 1, COUNT(t.id_track), " STATS_DURATION
+    " FROM AlbumTrack t JOIN Media m ON m.id_media = t.media_id GROUP BY t.album_id"
+    " UNION ALL "
+    "SELECT 2, t.genre_id, COUNT(DISTINCT t.album_id), COUNT(t.id_track), " STATS_DURATION
+    " FROM AlbumTrack t JOIN Media m ON m.id_media = t.media_id GROUP BY t.genre_id"
+    " UNION ALL "
+    "SELECT 3, t.artist_id, 0, COUNT(t.id_track), " STATS_DURATION
+    " FROM AlbumTrack t JOIN Media m ON m.id_media = t.media_id GROUP BY t.artist_id";
+
+bool
+fetchLibraryStatistics( const std::string& dbPath, LibraryStatistics& stats )
+{
+    stats.valid = false;
+    if ( dbPath.empty() == true )
+        return false;
+    sqlite3* db;
+    auto rc = sqlite3_open_v2( dbPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr );
+    if ( rc != SQLITE_OK )
+    {
+        LOGE( "Failed to open %s: %s", dbPath.c_str(), sqlite3_errmsg( db ) );
+        sqlite3_close( db );
+        return false;
+    }
+    // The medialibrary may be writing at the same time
+    sqlite3_busy_timeout( db, 500 );
+    sqlite3_stmt* stmt;
+    rc = sqlite3_prepare_v2( db, statsRequest, -1, &stmt, nullptr );
+    if ( rc != SQLITE_OK )
+    {
+        // Most likely a medialibrary schema change, callers will fall back
+        // to the per entity queries.
+        LOGE( "Failed to prepare statistics request: %s", sqlite3_errmsg( db ) );
+        sqlite3_close( db );
+        return false;
+    }
+    while ( ( rc = sqlite3_step( stmt ) ) == SQLITE_ROW )
+    {
+        LibraryStatistics::Counts counts;
+        counts.nbAlbums = sqlite3_column_int( stmt, 2 );
+        counts.nbTracks = sqlite3_column_int( stmt, 3 );
+        counts.duration = sqlite3_column_int64( stmt, 4 );
+        auto id = sqlite3_column_int64( stmt, 1 );
+        switch ( sqlite3_column_int( stmt, 0 ) )
+        {
+        case 0:
+            stats.artists[id].nbAlbums = counts.nbAlbums;
+            break;
+        case 3:
+        {
+            auto& artist = stats.artists[id];
+            artist.nbTracks = counts.nbTracks;
+            artist.duration = counts.duration;
+            break;
+        }
+        case 1:
+            stats.albums[id] = counts;
+            break;
+        case 2:
+            stats.genres[id] = counts;
+            break;
+        }
+    }
+    if ( rc != SQLITE_DONE )
+        LOGE( "Failed to fetch statistics: %s", sqlite3_errmsg( db ) );
+    else
+        stats.valid = true;
+    sqlite3_finalize( stmt );
+    sqlite3_close( db );
+    return stats.valid;
+}
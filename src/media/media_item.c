@@ -23,6 +23,10 @@
  *****************************************************************************/
 
 #include "common.h"
+
+#include <assert.h>
+#include <Eina.h>
+
 #include "media_item.h"
 
 media_item *
@@ -33,7 +37,8 @@ media_item_create(const char *psz_path, enum MEDIA_ITEM_TYPE i_type)
         return NULL;
 
     p_mi->i_library_item_type = LIBRARY_ITEM_MEDIA;
-    p_mi->psz_path = strdup(psz_path);
+    p_mi->i_refcount = 1;
+    p_mi->psz_path = eina_stringshare_add(psz_path);
     if (!p_mi->psz_path)
         goto error;
 
@@ -49,21 +54,22 @@ error:
 media_item*
 media_item_copy(const media_item* p_item)
 {
-    media_item* p_new = media_item_create(p_item->psz_path, p_item->i_type);
+    media_item* p_new = calloc(1, sizeof(media_item));
     if (p_new == NULL)
         return NULL;
+    p_new->i_library_item_type = LIBRARY_ITEM_MEDIA;
+    p_new->i_refcount = 1;
+    p_new->i_type = p_item->i_type;
+    /* Stringshares are immutable, so the copy only needs references */
+    p_new->psz_path = eina_stringshare_ref(p_item->psz_path);
     p_new->i_id = p_item->i_id;
     p_new->i_duration = p_item->i_duration;
     p_new->i_w = p_item->i_w;
     p_new->i_h = p_item->i_h;
     p_new->i_track_number = p_item->i_track_number;
     for (unsigned int i = 0; i < MEDIA_ITEM_META_COUNT; ++i)
-    {
-        if (p_item->psz_metas[i] != NULL)
-            p_new->psz_metas[i] = strdup( p_item->psz_metas[i]);
-    }
-    if (p_item->psz_snapshot != NULL)
-        p_new->psz_snapshot = strdup(p_item->psz_snapshot);
+        p_new->psz_metas[i] = eina_stringshare_ref(p_item->psz_metas[i]);
+    p_new->psz_snapshot = eina_stringshare_ref(p_item->psz_snapshot);
     return p_new;
 }
 
@@ -75,21 +81,66 @@ media_item_identical(const media_item* p_left, const media_item* p_right)
     return strcmp( p_left->psz_path, p_right->psz_path ) == 0;
 }
 
+bool
+media_item_equals(const media_item* p_left, const media_item* p_right)
+{
+    if ( media_item_identical( p_left, p_right ) == false )
+        return false;
+    /* Stringshares can be compared by address */
+    if ( p_left->i_type != p_right->i_type ||
+         p_left->i_duration != p_right->i_duration ||
+         p_left->i_w != p_right->i_w || p_left->i_h != p_right->i_h ||
+         p_left->i_track_number != p_right->i_track_number ||
+         p_left->psz_path != p_right->psz_path ||
+         p_left->psz_snapshot != p_right->psz_snapshot )
+        return false;
+    for ( unsigned int i = 0; i < MEDIA_ITEM_META_COUNT; ++i )
+    {
+        if ( p_left->psz_metas[i] != p_right->psz_metas[i] )
+            return false;
+    }
+    return true;
+}
+
+media_item*
+media_item_ref(media_item *p_mi)
+{
+    /* Items are created by the media library threads, and released from the main loop */
+    __sync_add_and_fetch(&p_mi->i_refcount, 1);
+    return p_mi;
+}
+
 void
-media_item_destroy(media_item *p_mi)
+media_item_unref(media_item *p_mi)
 {
-    free(p_mi->psz_snapshot);
+    if (__sync_sub_and_fetch(&p_mi->i_refcount, 1) != 0)
+        return;
+    eina_stringshare_del(p_mi->psz_snapshot);
     for (unsigned int i = 0; i < MEDIA_ITEM_META_COUNT; ++i)
-        free(p_mi->psz_metas[i]);
-    free(p_mi->psz_path);
+        eina_stringshare_del(p_mi->psz_metas[i]);
+    eina_stringshare_del(p_mi->psz_path);
     free(p_mi);
 }
 
+void
+media_item_destroy(media_item *p_mi)
+{
+    media_item_unref(p_mi);
+}
+
 int
 media_item_set_meta(media_item *p_mi, enum MEDIA_ITEM_META i_meta,
                     const char *psz_meta)
 {
-    free(p_mi->psz_metas[i_meta]);
-    p_mi->psz_metas[i_meta] = psz_meta ? strdup(psz_meta) : NULL;
+    assert(p_mi->i_refcount == 1);
+    eina_stringshare_replace(&p_mi->psz_metas[i_meta], psz_meta);
     return p_mi->psz_metas[i_meta] ? 0 : -1;
 }
+
+int
+media_item_set_snapshot(media_item *p_mi, const char *psz_snapshot)
+{
+    assert(p_mi->i_refcount == 1);
+    eina_stringshare_replace(&p_mi->psz_snapshot, psz_snapshot);
+    return p_mi->psz_snapshot ? 0 : -1;
+}
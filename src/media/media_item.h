@@ -55,35 +55,68 @@ enum MEDIA_ITEM_META {
 typedef struct media_item {
     LIBRARY_ITEM_COMMON
 
-    char *psz_path;                 /* Normalized path on the device */
+    /*
+     * All the strings are Eina_Stringshare: identical artist or album names
+     * are stored once, and copying an item only takes references.
+     * Use the setters below to modify them.
+     */
+    const char *psz_path;           /* Normalized path on the device */
     enum MEDIA_ITEM_TYPE i_type;    /* Video, Audio, Subs, etc... */
 
-    char *psz_metas[MEDIA_ITEM_META_COUNT];
+    const char *psz_metas[MEDIA_ITEM_META_COUNT];
     int64_t i_duration;             /* in ms */
 
     //FIXME replace with a union
     int i_w, i_h;                   /* in pixels */
 
-    char* psz_snapshot;             /* Path to a snapshot file */
-    int64_t i_id;                  /* Opaque file type specific ID, provided by the media library */
+    const char* psz_snapshot;       /* Path to a snapshot file */
     uint16_t i_track_number;        /* Track number, or 0 if unknown or not part of an album */
+
+    unsigned int i_refcount;        /* Use media_item_ref/media_item_unref */
 } media_item;
 
 media_item *
 media_item_create(const char *psz_path, enum MEDIA_ITEM_TYPE i_type);
 
+/*
+ * Returns a new, unshared, item holding the same content. Only needed before
+ * modifying an item: sharing it is done with media_item_ref
+ */
 media_item*
 media_item_copy(const media_item* p_item);
 
+/*
+ * Items are shared between the library, the controllers, the views and the
+ * playback service. They must be considered immutable once shared.
+ */
+media_item*
+media_item_ref(media_item *p_mi);
+
+/* The item is freed when its last reference is released */
+void
+media_item_unref(media_item *p_mi);
+
+/* Same as media_item_unref */
 void
 media_item_destroy(media_item *p_mi);
 
 bool
 media_item_identical(const media_item* p_left, const media_item* p_right);
 
+/* Returns true if both items hold the exact same content */
+bool
+media_item_equals(const media_item* p_left, const media_item* p_right);
+
+/*
+ * The setters can only be used on items that aren't shared yet. To modify a
+ * shared item, modify a copy of it, and replace the shared one.
+ */
 int
 media_item_set_meta(media_item *p_mi, enum MEDIA_ITEM_META i_meta, const char *psz_meta);
 
+int
+media_item_set_snapshot(media_item *p_mi, const char *psz_snapshot);
+
 static inline const char *
 media_item_get_filename(const media_item *p_mi)
 {
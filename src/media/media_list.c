@@ -30,15 +30,72 @@
 
 #include "media_list.h"
 
+/* Number of items per chunk: editing the list moves at most that many items,
+ * plus one pointer per chunk */
+#define ML_CHUNK_SIZE 256
+
+struct ml_chunk;
+
+/* A queued item. Entries keep their identity when the list is edited, which
+ * the shuffle order relies on, since the same item can be queued twice. */
+typedef struct ml_entry
+{
+    media_item *p_mi;
+    struct ml_chunk *p_chunk;
+    unsigned int i_slot;        /* index in p_chunk */
+
+    unsigned int i_cycle;       /* shuffle cycle it was played in, 0 if none */
+    int i_history;              /* index in the shuffle history, or -1 */
+    int i_pool;                 /* index in the shuffle pool, or -1 */
+} ml_entry;
+
+typedef struct ml_chunk
+{
+    unsigned int i_index;       /* index in pp_chunks */
+    unsigned int i_count;
+    ml_entry *pp_entries[ML_CHUNK_SIZE];
+} ml_chunk;
+
 struct media_list
 {
     Eina_List *p_cbs_list;
-    Eina_Array *p_item_array;
+
+    /*
+     * The items are stored in a chunked array. pi_offsets holds the index of
+     * the first item of each chunk; only the first i_offsets_valid entries
+     * are up to date, the others are recomputed on the next lookup, so that
+     * successive edits don't pay for it.
+     */
+    ml_chunk **pp_chunks;
+    unsigned int *pi_offsets;
+    unsigned int i_chunks;
+    unsigned int i_chunks_alloc;
+    unsigned int i_offsets_valid;
+    unsigned int i_count;
+
     media_item *p_mi;
     int i_pos;
     bool b_free_media;
 
     enum PLAYLIST_REPEAT i_repeat;
+
+    /*
+     * Shuffle: each cycle plays every entry once, in a random order drawn one
+     * entry at a time. Entries played during the cycle are recorded in
+     * p_history, which prev/next walk before drawing new ones. Unplayed
+     * entries are drawn by rejection while most of them are left, then from
+     * p_pool, which is only built once half of the cycle was played.
+     */
+    bool b_shuffle;
+    uint64_t i_rand;
+    unsigned int i_cycle;
+    unsigned int i_played;
+    Eina_Array *p_history;      /* ml_entry*, NULL for removed entries */
+    int i_history_pos;
+    int i_history_max;          /* furthest position played: the entries
+                                 * after it were only peeked */
+    Eina_Array *p_pool;         /* ml_entry*, when b_pool */
+    bool b_pool;
 };
 
 #define ML_SEND_CALLBACK(pf_cb, ...) do { \
@@ -50,16 +107,495 @@ struct media_list
 } while (0)
 
 #define ML_CLIP_POS(i_pos) do { \
-    if (i_pos >= (int)eina_array_count(p_ml->p_item_array)) \
-        i_pos = eina_array_count(p_ml->p_item_array) - 1; \
+    if (i_pos >= (int)p_ml->i_count) \
+        i_pos = p_ml->i_count - 1; \
 } while (0)
 
+/*****************/
+/* chunked array */
+/*****************/
+
+static void
+ml_offsets_invalidate(media_list *p_ml, unsigned int i_chunk)
+{
+    if (p_ml->i_offsets_valid > i_chunk)
+        p_ml->i_offsets_valid = i_chunk;
+}
+
+static void
+ml_offsets_update(media_list *p_ml)
+{
+    for (unsigned int i = p_ml->i_offsets_valid; i < p_ml->i_chunks; ++i)
+        p_ml->pi_offsets[i] = i == 0 ? 0 : p_ml->pi_offsets[i - 1] + p_ml->pp_chunks[i - 1]->i_count;
+    p_ml->i_offsets_valid = p_ml->i_chunks;
+}
+
+/* Returns the chunk holding i_index, and the index within that chunk.
+ * i_index == i_count returns the end of the last chunk. */
+static unsigned int
+ml_locate(media_list *p_ml, unsigned int i_index, unsigned int *pi_in_chunk)
+{
+    unsigned int i_low = 0, i_high = p_ml->i_chunks - 1;
+
+    assert(p_ml->i_chunks > 0 && i_index <= p_ml->i_count);
+
+    ml_offsets_update(p_ml);
+
+    /* Last chunk starting at or before i_index */
+    while (i_low < i_high)
+    {
+        unsigned int i_mid = (i_low + i_high + 1) / 2;
+        if (p_ml->pi_offsets[i_mid] <= i_index)
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
+    }
+
+    *pi_in_chunk = i_index - p_ml->pi_offsets[i_low];
+    return i_low;
+}
+
+static ml_entry *
+ml_entry_at(media_list *p_ml, unsigned int i_index)
+{
+    unsigned int i_in_chunk;
+
+    if (i_index >= p_ml->i_count)
+        return NULL;
+    unsigned int i_chunk = ml_locate(p_ml, i_index, &i_in_chunk);
+    return p_ml->pp_chunks[i_chunk]->pp_entries[i_in_chunk];
+}
+
+static media_item *
+ml_item_at(media_list *p_ml, unsigned int i_index)
+{
+    ml_entry *p_entry = ml_entry_at(p_ml, i_index);
+    return p_entry ? p_entry->p_mi : NULL;
+}
+
+static unsigned int
+ml_entry_index(media_list *p_ml, const ml_entry *p_entry)
+{
+    ml_offsets_update(p_ml);
+    return p_ml->pi_offsets[p_entry->p_chunk->i_index] + p_entry->i_slot;
+}
+
+/* Updates the location of the entries of p_chunk from i_from */
+static void
+ml_chunk_reslot(ml_chunk *p_chunk, unsigned int i_from)
+{
+    for (unsigned int i = i_from; i < p_chunk->i_count; ++i)
+    {
+        p_chunk->pp_entries[i]->p_chunk = p_chunk;
+        p_chunk->pp_entries[i]->i_slot = i;
+    }
+}
+
+static void
+ml_chunks_reindex(media_list *p_ml, unsigned int i_from)
+{
+    for (unsigned int i = i_from; i < p_ml->i_chunks; ++i)
+        p_ml->pp_chunks[i]->i_index = i;
+    ml_offsets_invalidate(p_ml, i_from);
+}
+
+/* Inserts a new empty chunk at i_chunk */
+static ml_chunk *
+ml_chunk_insert(media_list *p_ml, unsigned int i_chunk)
+{
+    if (p_ml->i_chunks == p_ml->i_chunks_alloc)
+    {
+        unsigned int i_alloc = p_ml->i_chunks_alloc ? p_ml->i_chunks_alloc * 2 : 4;
+        ml_chunk **pp_chunks = realloc(p_ml->pp_chunks, i_alloc * sizeof(*pp_chunks));
+        if (!pp_chunks)
+            return NULL;
+        p_ml->pp_chunks = pp_chunks;
+        unsigned int *pi_offsets = realloc(p_ml->pi_offsets, i_alloc * sizeof(*pi_offsets));
+        if (!pi_offsets)
+            return NULL;
+        p_ml->pi_offsets = pi_offsets;
+        p_ml->i_chunks_alloc = i_alloc;
+    }
+
+    ml_chunk *p_chunk = malloc(sizeof(*p_chunk));
+    if (!p_chunk)
+        return NULL;
+    p_chunk->i_count = 0;
+
+    memmove(&p_ml->pp_chunks[i_chunk + 1], &p_ml->pp_chunks[i_chunk],
+            (p_ml->i_chunks - i_chunk) * sizeof(*p_ml->pp_chunks));
+    p_ml->pp_chunks[i_chunk] = p_chunk;
+    p_ml->i_chunks++;
+    ml_chunks_reindex(p_ml, i_chunk);
+    return p_chunk;
+}
+
+static void
+ml_chunk_remove(media_list *p_ml, unsigned int i_chunk)
+{
+    free(p_ml->pp_chunks[i_chunk]);
+    memmove(&p_ml->pp_chunks[i_chunk], &p_ml->pp_chunks[i_chunk + 1],
+            (p_ml->i_chunks - i_chunk - 1) * sizeof(*p_ml->pp_chunks));
+    p_ml->i_chunks--;
+    ml_chunks_reindex(p_ml, i_chunk);
+}
+
+/* Inserts p_entry at i_index (<= i_count), without any notification */
+static bool
+ml_insert_at(media_list *p_ml, unsigned int i_index, ml_entry *p_entry)
+{
+    unsigned int i_chunk, i_in_chunk;
+    ml_chunk *p_chunk;
+
+    if (p_ml->i_chunks == 0 && !ml_chunk_insert(p_ml, 0))
+        return false;
+
+    i_chunk = ml_locate(p_ml, i_index, &i_in_chunk);
+    p_chunk = p_ml->pp_chunks[i_chunk];
+
+    if (p_chunk->i_count == ML_CHUNK_SIZE)
+    {
+        /* Split the full chunk in two halves */
+        ml_chunk *p_next = ml_chunk_insert(p_ml, i_chunk + 1);
+        if (!p_next)
+            return false;
+        p_next->i_count = ML_CHUNK_SIZE / 2;
+        p_chunk->i_count = ML_CHUNK_SIZE - p_next->i_count;
+        memcpy(p_next->pp_entries, &p_chunk->pp_entries[p_chunk->i_count],
+               p_next->i_count * sizeof(*p_chunk->pp_entries));
+        ml_chunk_reslot(p_next, 0);
+
+        if (i_in_chunk > p_chunk->i_count)
+        {
+            i_in_chunk -= p_chunk->i_count;
+            p_chunk = p_next;
+            i_chunk++;
+        }
+    }
+
+    memmove(&p_chunk->pp_entries[i_in_chunk + 1], &p_chunk->pp_entries[i_in_chunk],
+            (p_chunk->i_count - i_in_chunk) * sizeof(*p_chunk->pp_entries));
+    p_chunk->pp_entries[i_in_chunk] = p_entry;
+    p_chunk->i_count++;
+    ml_chunk_reslot(p_chunk, i_in_chunk);
+    p_ml->i_count++;
+    ml_offsets_invalidate(p_ml, i_chunk + 1);
+    return true;
+}
+
+/* Removes the entry at i_index (< i_count), without any notification */
+static ml_entry *
+ml_remove_at(media_list *p_ml, unsigned int i_index)
+{
+    unsigned int i_in_chunk;
+    unsigned int i_chunk = ml_locate(p_ml, i_index, &i_in_chunk);
+    ml_chunk *p_chunk = p_ml->pp_chunks[i_chunk];
+    ml_entry *p_entry = p_chunk->pp_entries[i_in_chunk];
+
+    p_chunk->i_count--;
+    memmove(&p_chunk->pp_entries[i_in_chunk], &p_chunk->pp_entries[i_in_chunk + 1],
+            (p_chunk->i_count - i_in_chunk) * sizeof(*p_chunk->pp_entries));
+    ml_chunk_reslot(p_chunk, i_in_chunk);
+    p_ml->i_count--;
+    ml_offsets_invalidate(p_ml, i_chunk + 1);
+
+    if (p_chunk->i_count == 0)
+    {
+        ml_chunk_remove(p_ml, i_chunk);
+    }
+    else if (i_chunk + 1 < p_ml->i_chunks &&
+             p_chunk->i_count + p_ml->pp_chunks[i_chunk + 1]->i_count <= ML_CHUNK_SIZE / 2)
+    {
+        /* Merge small neighbours so that lookups stay short */
+        ml_chunk *p_next = p_ml->pp_chunks[i_chunk + 1];
+        unsigned int i_from = p_chunk->i_count;
+        memcpy(&p_chunk->pp_entries[i_from], p_next->pp_entries,
+               p_next->i_count * sizeof(*p_next->pp_entries));
+        p_chunk->i_count += p_next->i_count;
+        ml_chunk_reslot(p_chunk, i_from);
+        ml_chunk_remove(p_ml, i_chunk + 1);
+    }
+    return p_entry;
+}
+
+/***********/
+/* shuffle */
+/***********/
+
+/* splitmix64: a small generator, so that a seed gives the same order on
+ * every device */
+static uint64_t
+ml_random(media_list *p_ml)
+{
+    uint64_t z = (p_ml->i_rand += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+static void
+ml_shuffle_history_push(media_list *p_ml, ml_entry *p_entry)
+{
+    /* An entry selected again only keeps its latest place */
+    if (p_entry->i_history >= 0)
+        eina_array_data_set(p_ml->p_history, p_entry->i_history, NULL);
+    if (!eina_array_push(p_ml->p_history, p_entry))
+    {
+        p_entry->i_history = -1;
+        return;
+    }
+    p_entry->i_history = eina_array_count(p_ml->p_history) - 1;
+}
+
+static void
+ml_shuffle_set_history_pos(media_list *p_ml, int i_pos)
+{
+    p_ml->i_history_pos = i_pos;
+    if (i_pos > p_ml->i_history_max)
+        p_ml->i_history_max = i_pos;
+}
+
+/* Drops the history after the current entry */
+static void
+ml_shuffle_history_truncate(media_list *p_ml)
+{
+    while ((int)eina_array_count(p_ml->p_history) > p_ml->i_history_pos + 1)
+    {
+        int i_index = eina_array_count(p_ml->p_history) - 1;
+        ml_entry *p_entry = eina_array_pop(p_ml->p_history);
+        if (!p_entry)
+            continue;
+        p_entry->i_history = -1;
+
+        /* Only peeked for gapless: it can still be drawn in this cycle */
+        if (i_index > p_ml->i_history_max && p_entry->i_cycle == p_ml->i_cycle)
+        {
+            p_entry->i_cycle = 0;
+            p_ml->i_played--;
+            if (p_ml->b_pool && eina_array_push(p_ml->p_pool, p_entry))
+                p_entry->i_pool = eina_array_count(p_ml->p_pool) - 1;
+        }
+    }
+    if (p_ml->i_history_max > p_ml->i_history_pos)
+        p_ml->i_history_max = p_ml->i_history_pos;
+}
+
+static void
+ml_shuffle_pool_remove(media_list *p_ml, ml_entry *p_entry)
+{
+    if (p_entry->i_pool < 0)
+        return;
+
+    ml_entry *p_last = eina_array_pop(p_ml->p_pool);
+    if (p_last != p_entry)
+    {
+        eina_array_data_set(p_ml->p_pool, p_entry->i_pool, p_last);
+        p_last->i_pool = p_entry->i_pool;
+    }
+    p_entry->i_pool = -1;
+}
+
+static void
+ml_shuffle_mark_played(media_list *p_ml, ml_entry *p_entry)
+{
+    if (p_entry->i_cycle == p_ml->i_cycle)
+        return;
+    p_entry->i_cycle = p_ml->i_cycle;
+    p_ml->i_played++;
+    ml_shuffle_pool_remove(p_ml, p_entry);
+}
+
+static void
+ml_shuffle_reset(media_list *p_ml)
+{
+    ml_entry *p_entry;
+
+    p_ml->i_history_pos = -1;
+    ml_shuffle_history_truncate(p_ml);
+    while ((p_entry = eina_array_pop(p_ml->p_pool)) != NULL)
+        p_entry->i_pool = -1;
+    p_ml->b_pool = false;
+    p_ml->i_played = 0;
+    /* Entries played in the previous cycles are simply not marked with the
+     * new one: starting a cycle doesn't touch them */
+    if (++p_ml->i_cycle == 0)
+        p_ml->i_cycle = 1;
+}
+
+/* Starts a new cycle, p_first being already played in it */
+static void
+ml_shuffle_new_cycle(media_list *p_ml, ml_entry *p_first)
+{
+    ml_shuffle_reset(p_ml);
+    if (p_first)
+    {
+        ml_shuffle_mark_played(p_ml, p_first);
+        ml_shuffle_history_push(p_ml, p_first);
+        ml_shuffle_set_history_pos(p_ml, p_first->i_history);
+    }
+}
+
+/* Draws an entry not played yet during this cycle, or NULL */
+static ml_entry *
+ml_shuffle_draw(media_list *p_ml)
+{
+    ml_entry *p_entry;
+
+    if (p_ml->i_played >= p_ml->i_count)
+        return NULL;
+
+    if (!p_ml->b_pool && p_ml->i_played * 2 >= p_ml->i_count)
+    {
+        /* Rejection would become slow: gather the remaining entries */
+        for (unsigned int i = 0; i < p_ml->i_chunks; ++i)
+        {
+            ml_chunk *p_chunk = p_ml->pp_chunks[i];
+            for (unsigned int j = 0; j < p_chunk->i_count; ++j)
+            {
+                p_entry = p_chunk->pp_entries[j];
+                if (p_entry->i_cycle == p_ml->i_cycle)
+                    continue;
+                if (!eina_array_push(p_ml->p_pool, p_entry))
+                    break;
+                p_entry->i_pool = eina_array_count(p_ml->p_pool) - 1;
+            }
+        }
+        p_ml->b_pool = true;
+    }
+
+    if (p_ml->b_pool && eina_array_count(p_ml->p_pool) > 0)
+    {
+        unsigned int i_pick = ml_random(p_ml) % eina_array_count(p_ml->p_pool);
+        p_entry = eina_array_data_get(p_ml->p_pool, i_pick);
+    }
+    else
+    {
+        /* More than half of the entries are left: 2 tries on average */
+        do
+            p_entry = ml_entry_at(p_ml, ml_random(p_ml) % p_ml->i_count);
+        while (p_entry->i_cycle == p_ml->i_cycle);
+    }
+
+    ml_shuffle_mark_played(p_ml, p_entry);
+    return p_entry;
+}
+
+/* Returns the entry after the current one in the shuffle order, drawing it
+ * if needed, or NULL at the end of the cycle */
+static ml_entry *
+ml_shuffle_peek_next(media_list *p_ml)
+{
+    unsigned int i_history_count = eina_array_count(p_ml->p_history);
+
+    for (unsigned int i = p_ml->i_history_pos + 1; i < i_history_count; ++i)
+    {
+        ml_entry *p_entry = eina_array_data_get(p_ml->p_history, i);
+        if (p_entry)
+            return p_entry;
+    }
+
+    ml_entry *p_entry = ml_shuffle_draw(p_ml);
+    if (!p_entry && p_ml->i_repeat == REPEAT_ALL && p_ml->i_count > 0)
+    {
+        /* Every entry was played: start another cycle */
+        ml_shuffle_new_cycle(p_ml, p_ml->i_pos >= 0 ? ml_entry_at(p_ml, p_ml->i_pos) : NULL);
+        p_entry = ml_shuffle_draw(p_ml);
+        if (!p_entry)
+            p_entry = ml_entry_at(p_ml, p_ml->i_pos >= 0 ? p_ml->i_pos : 0);
+    }
+    if (p_entry)
+        ml_shuffle_history_push(p_ml, p_entry);
+    return p_entry;
+}
+
+static int
+ml_shuffle_prev_pos(media_list *p_ml)
+{
+    for (int i = p_ml->i_history_pos - 1; i >= 0; --i)
+        if (eina_array_data_get(p_ml->p_history, i))
+            return i;
+    return -1;
+}
+
+/* Records an explicit selection in the shuffle history */
+static void
+ml_shuffle_selected(media_list *p_ml, ml_entry *p_entry)
+{
+    if (p_entry->i_history >= 0 && p_entry->i_history == p_ml->i_history_pos)
+        return;
+    ml_shuffle_mark_played(p_ml, p_entry);
+    ml_shuffle_history_truncate(p_ml);
+    ml_shuffle_history_push(p_ml, p_entry);
+    ml_shuffle_set_history_pos(p_ml, p_entry->i_history);
+}
+
+static void
+ml_shuffle_on_removed(media_list *p_ml, ml_entry *p_entry)
+{
+    if (p_entry->i_cycle == p_ml->i_cycle && p_ml->i_played > 0)
+        p_ml->i_played--;
+    if (p_entry->i_history >= 0)
+        eina_array_data_set(p_ml->p_history, p_entry->i_history, NULL);
+    ml_shuffle_pool_remove(p_ml, p_entry);
+}
+
+/*********/
+/* items */
+/*********/
+
+static ml_entry *
+ml_entry_create(media_item *p_mi)
+{
+    ml_entry *p_entry = calloc(1, sizeof(*p_entry));
+    if (!p_entry)
+        return NULL;
+    p_entry->p_mi = p_mi;
+    p_entry->i_history = -1;
+    p_entry->i_pool = -1;
+    return p_entry;
+}
+
+/* Empties the list, without any notification */
+static void
+ml_flush(media_list *p_ml)
+{
+    ml_shuffle_reset(p_ml);
+
+    for (unsigned int i = 0; i < p_ml->i_chunks; ++i)
+    {
+        ml_chunk *p_chunk = p_ml->pp_chunks[i];
+        for (unsigned int j = 0; j < p_chunk->i_count; ++j)
+        {
+            if (p_ml->b_free_media)
+                media_item_destroy(p_chunk->pp_entries[j]->p_mi);
+            free(p_chunk->pp_entries[j]);
+        }
+        free(p_chunk);
+    }
+    p_ml->i_chunks = 0;
+    p_ml->i_offsets_valid = 0;
+    p_ml->i_count = 0;
+}
+
+/**************/
+/* media_list */
+/**************/
+
 static void
 media_list_on_new_pos(media_list *p_ml)
 {
     ML_SEND_CALLBACK(pf_on_media_selected, p_ml->i_pos, p_ml->p_mi);
 }
 
+/* Makes i_index the current media and notifies it */
+static void
+media_list_select(media_list *p_ml, int i_index)
+{
+    p_ml->i_pos = i_index;
+    p_ml->p_mi = p_ml->i_pos >= 0 ? ml_item_at(p_ml, p_ml->i_pos) : NULL;
+    media_list_on_new_pos(p_ml);
+}
+
 static void
 media_list_on_media_added(media_list *p_ml, unsigned int i_index, media_item *p_mi)
 {
@@ -76,13 +612,6 @@ media_list_on_media_added(media_list *p_ml, unsigned int i_index, media_item *p_
 static void
 media_list_on_media_removed(media_list *p_ml, unsigned int i_index, media_item *p_mi)
 {
-    if (p_ml->i_pos >= 0 && p_ml->i_pos >= i_index)
-    {
-        // A media has been removed before the current media
-        // we need to shift its position.
-        p_ml->i_pos--;
-    }
-
     ML_SEND_CALLBACK(pf_on_media_removed, i_index, p_mi);
 
     if (p_ml->b_free_media)
@@ -95,9 +624,12 @@ media_list_create(bool b_free_media)
     media_list *p_ml = calloc(1, sizeof(media_list));
     if (!p_ml)
         return NULL;
-    p_ml->p_item_array = eina_array_new(30);
-    if (!p_ml->p_item_array)
+    p_ml->p_history = eina_array_new(64);
+    p_ml->p_pool = eina_array_new(64);
+    if (!p_ml->p_history || !p_ml->p_pool)
     {
+        if (p_ml->p_history)
+            eina_array_free(p_ml->p_history);
         free(p_ml);
         return NULL;
     }
@@ -105,6 +637,9 @@ media_list_create(bool b_free_media)
     p_ml->b_free_media = b_free_media;
     p_ml->i_pos = -1;
     p_ml->i_repeat = REPEAT_NONE;
+    p_ml->i_history_pos = p_ml->i_history_max = -1;
+    /* 0 marks the entries not played in any cycle */
+    p_ml->i_cycle = 1;
     return p_ml;
 }
 
@@ -121,7 +656,10 @@ media_list_destroy(media_list *p_ml)
     p_ml->p_cbs_list = NULL;
 
     media_list_clear(p_ml);
-    eina_array_free(p_ml->p_item_array);
+    eina_array_free(p_ml->p_history);
+    eina_array_free(p_ml->p_pool);
+    free(p_ml->pp_chunks);
+    free(p_ml->pi_offsets);
     free(p_ml);
 }
 
@@ -153,70 +691,183 @@ media_list_unregister_callbacks(media_list *p_ml, media_list_cbs_id *p_id)
 int
 media_list_insert(media_list *p_ml, int i_index, media_item *p_mi)
 {
-    if (i_index < 0)
+    if (i_index < 0 || i_index > (int)p_ml->i_count)
+        i_index = p_ml->i_count;
+
+    ml_entry *p_entry = ml_entry_create(p_mi);
+    if (!p_entry)
+        return -1;
+    if (!ml_insert_at(p_ml, i_index, p_entry))
     {
-        if (!eina_array_push(p_ml->p_item_array, p_mi))
-            return -1;
+        free(p_entry);
+        return -1;
     }
-    else
+    if (p_ml->b_pool && eina_array_push(p_ml->p_pool, p_entry))
+        p_entry->i_pool = eina_array_count(p_ml->p_pool) - 1;
+
+    media_list_on_media_added(p_ml, i_index, p_mi);
+
+    if (p_ml->i_pos == -1)
+        media_list_set_pos(p_ml, 0);
+
+    return 0;
+}
+
+/* Removes all the items and notifies it, leaving the current position as is */
+static void
+media_list_empty(media_list *p_ml)
+{
+    Eina_List *p_el;
+    media_list_callbacks *p_cbs;
+
+    if (p_ml->i_count == 0)
+        return;
+
+    /* One notification for the whole list, unless the listener only
+     * handles removals one by one */
+    EINA_LIST_FOREACH(p_ml->p_cbs_list, p_el, p_cbs)
     {
-        unsigned int i_count;
-        /* increase array size */
-        if (!eina_array_push(p_ml->p_item_array, p_mi)) // dummy data
-            return -1;
+        if (p_cbs->pf_on_cleared)
+            p_cbs->pf_on_cleared(p_ml, p_cbs->p_user_data, p_ml->i_count);
+        else if (p_cbs->pf_on_media_removed)
+        {
+            for (unsigned int i = 0; i < p_ml->i_count; ++i)
+                p_cbs->pf_on_media_removed(p_ml, p_cbs->p_user_data, i, ml_item_at(p_ml, i));
+        }
+    }
+    ml_flush(p_ml);
+}
+
+/* Inserts the items of p_array at i_index and notifies them as one range,
+ * without selecting any */
+static int
+media_list_insert_range(media_list *p_ml, unsigned int i_index, Eina_Array *p_array)
+{
+    Eina_List *p_el;
+    media_list_callbacks *p_cbs;
+    unsigned int i_count = eina_array_count(p_array);
+    unsigned int i_added = 0;
 
-        /* "memmove" */
-        i_count = eina_array_count(p_ml->p_item_array);
-        for (unsigned int i = i_count - 1; i > i_index; --i)
+    for (; i_added < i_count; ++i_added)
+    {
+        ml_entry *p_entry = ml_entry_create(eina_array_data_get(p_array, i_added));
+        if (!p_entry)
+            break;
+        if (!ml_insert_at(p_ml, i_index + i_added, p_entry))
         {
-            media_item *p_move_mi = eina_array_data_get(p_ml->p_item_array, i - 1);
-            eina_array_data_set(p_ml->p_item_array, i, p_move_mi);
+            free(p_entry);
+            break;
         }
-        eina_array_data_set(p_ml->p_item_array, i_index, p_mi);
+        if (p_ml->b_pool && eina_array_push(p_ml->p_pool, p_entry))
+            p_entry->i_pool = eina_array_count(p_ml->p_pool) - 1;
     }
+    /* The list owns the items, even those it could not insert */
+    if (p_ml->b_free_media)
+        for (unsigned int i = i_added; i < i_count; ++i)
+            media_item_destroy(eina_array_data_get(p_array, i));
+    if (i_added == 0)
+        return i_count == 0 ? 0 : -1;
 
-    media_list_on_media_added(p_ml, i_index, p_mi);
+    if (p_ml->i_pos >= 0 && p_ml->i_pos >= (int)i_index)
+        p_ml->i_pos += i_added;
 
-    if (p_ml->i_pos == -1)
+    EINA_LIST_FOREACH(p_ml->p_cbs_list, p_el, p_cbs)
+    {
+        if (p_cbs->pf_on_range_added)
+            p_cbs->pf_on_range_added(p_ml, p_cbs->p_user_data, i_index, i_added);
+        else if (p_cbs->pf_on_media_added)
+        {
+            for (unsigned int i = 0; i < i_added; ++i)
+                p_cbs->pf_on_media_added(p_ml, p_cbs->p_user_data, i_index + i,
+                                         ml_item_at(p_ml, i_index + i));
+        }
+    }
+
+    return i_added == i_count ? 0 : -1;
+}
+
+int
+media_list_insert_many(media_list *p_ml, int i_index, Eina_Array *p_array)
+{
+    if (i_index < 0 || i_index > (int)p_ml->i_count)
+        i_index = p_ml->i_count;
+
+    int i_ret = media_list_insert_range(p_ml, i_index, p_array);
+
+    if (p_ml->i_pos == -1 && p_ml->i_count > 0)
         media_list_set_pos(p_ml, 0);
 
-    return 0;
+    return i_ret;
 }
 
-static Eina_Bool
-media_list_array_keep_cb(void *p_data, void *p_user_data)
+int
+media_list_replace(media_list *p_ml, Eina_Array *p_array, int i_pos)
 {
-   return (p_data == p_user_data) ? EINA_FALSE : EINA_TRUE;
+    bool b_had_pos = p_ml->i_pos != -1;
+
+    /* The new current media is only notified once the list is filled: going
+     * through -1 would stop the playback */
+    media_list_empty(p_ml);
+    p_ml->i_pos = -1;
+    p_ml->p_mi = NULL;
+
+    int i_ret = media_list_insert_range(p_ml, 0, p_array);
+
+    if (p_ml->i_count > 0)
+    {
+        if (i_pos < 0)
+            i_pos = 0;
+        media_list_set_pos(p_ml, i_pos);
+    }
+    else if (b_had_pos)
+        media_list_on_new_pos(p_ml);
+
+    return i_ret;
 }
 
 static int
-media_list_remove_common(media_list *p_ml, unsigned int i_index, media_item *p_mi)
+media_list_remove_common(media_list *p_ml, unsigned int i_index)
 {
-    int i_prev_count = eina_array_count(p_ml->p_item_array);
+    /* Items are shared, so the same one can be queued more than once: remove
+     * it by index rather than by value */
+    ml_entry *p_entry = ml_remove_at(p_ml, i_index);
+    media_item *p_mi = p_entry->p_mi;
+    bool b_current = p_ml->i_pos == (int)i_index;
 
-    if (!eina_array_remove(p_ml->p_item_array, media_list_array_keep_cb, p_mi))
-        return -1;
+    ml_shuffle_on_removed(p_ml, p_entry);
+    free(p_entry);
 
-    assert(eina_array_count(p_ml->p_item_array) != i_prev_count);
+    if (p_ml->i_count == 0)
+        p_ml->i_pos = -1;
+    else if (b_current)
+        ML_CLIP_POS(p_ml->i_pos);
+    else if ((int)i_index < p_ml->i_pos)
+        p_ml->i_pos--;
 
     media_list_on_media_removed(p_ml, i_index, p_mi);
 
-    if (eina_array_count(p_ml->p_item_array) == 0)
+    if (p_ml->i_count == 0)
     {
         /* notify there if no more current media */
-        p_ml->i_pos = -1;
         p_ml->p_mi = NULL;
         media_list_on_new_pos(p_ml);
     }
-    else if (p_ml->i_pos == i_index)
+    else if (b_current)
     {
         /* notify current media changed */
-        p_ml->p_mi = eina_array_data_get(p_ml->p_item_array, p_ml->i_pos);
-        media_list_on_new_pos(p_ml);
-    }
-    else if (i_index < p_ml->i_pos)
-    {
-        p_ml->i_pos--;
+        if (p_ml->b_shuffle)
+        {
+            /* Go on with the shuffle order rather than the neighbour */
+            ml_entry *p_next = ml_shuffle_peek_next(p_ml);
+            if (p_next)
+            {
+                ml_shuffle_set_history_pos(p_ml, p_next->i_history);
+                p_ml->i_pos = ml_entry_index(p_ml, p_next);
+            }
+            else
+                ml_shuffle_selected(p_ml, ml_entry_at(p_ml, p_ml->i_pos));
+        }
+        media_list_select(p_ml, p_ml->i_pos);
     }
 
     return 0;
@@ -225,14 +876,16 @@ media_list_remove_common(media_list *p_ml, unsigned int i_index, media_item *p_m
 int
 media_list_remove(media_list *p_ml, media_item *p_mi)
 {
-    media_item *p_iter_mi;
-    Eina_Array_Iterator iterator;
-    unsigned int i;
+    unsigned int i_index = 0;
 
-    EINA_ARRAY_ITER_NEXT(p_ml->p_item_array, i, p_iter_mi, iterator)
+    for (unsigned int i = 0; i < p_ml->i_chunks; ++i)
     {
-        if (p_iter_mi == p_mi)
-            return media_list_remove_common(p_ml, i, p_mi);
+        ml_chunk *p_chunk = p_ml->pp_chunks[i];
+        for (unsigned int j = 0; j < p_chunk->i_count; ++j, ++i_index)
+        {
+            if (p_chunk->pp_entries[j]->p_mi == p_mi)
+                return media_list_remove_common(p_ml, i_index);
+        }
     }
     return -1;
 }
@@ -240,23 +893,44 @@ media_list_remove(media_list *p_ml, media_item *p_mi)
 int
 media_list_remove_index(media_list *p_ml, unsigned int i_index)
 {
+    if (p_ml->i_count == 0)
+        return -1;
     ML_CLIP_POS(i_index);
-    media_item *p_mi = eina_array_data_get(p_ml->p_item_array, i_index);
-    if (!p_mi)
+    return media_list_remove_common(p_ml, i_index);
+}
+
+int
+media_list_move(media_list *p_ml, unsigned int i_from, unsigned int i_to)
+{
+    if (i_from >= p_ml->i_count || i_to >= p_ml->i_count)
         return -1;
-    return media_list_remove_common(p_ml, i_index, p_mi);
+    if (i_from == i_to)
+        return 0;
+
+    ml_entry *p_entry = ml_remove_at(p_ml, i_from);
+    if (!ml_insert_at(p_ml, i_to, p_entry))
+    {
+        /* Can only fail when allocating a chunk: put it back where it was */
+        ml_insert_at(p_ml, i_from, p_entry);
+        return -1;
+    }
+
+    if (p_ml->i_pos == (int)i_from)
+        p_ml->i_pos = i_to;
+    else if ((int)i_from < p_ml->i_pos && (int)i_to >= p_ml->i_pos)
+        p_ml->i_pos--;
+    else if ((int)i_from > p_ml->i_pos && (int)i_to <= p_ml->i_pos && p_ml->i_pos >= 0)
+        p_ml->i_pos++;
+
+    ML_SEND_CALLBACK(pf_on_media_removed, i_from, p_entry->p_mi);
+    ML_SEND_CALLBACK(pf_on_media_added, i_to, p_entry->p_mi);
+    return 0;
 }
 
 void
 media_list_clear(media_list *p_ml)
 {
-    media_item *p_mi;
-    Eina_Array_Iterator iterator;
-    unsigned int i;
-
-    EINA_ARRAY_ITER_NEXT(p_ml->p_item_array, i, p_mi, iterator)
-        media_list_on_media_removed(p_ml, i, p_mi);
-    eina_array_flush(p_ml->p_item_array);
+    media_list_empty(p_ml);
 
     if (p_ml->i_pos != -1)
     {
@@ -269,7 +943,7 @@ media_list_clear(media_list *p_ml)
 unsigned int
 media_list_get_count(media_list *p_ml)
 {
-    return eina_array_count(p_ml->p_item_array);
+    return p_ml->i_count;
 }
 
 int
@@ -284,18 +958,18 @@ media_list_set_pos(media_list *p_ml, int i_index)
     ML_CLIP_POS(i_index);
     if (i_index != p_ml->i_pos || p_ml->i_repeat == REPEAT_ONE)
     {
-        p_ml->i_pos = i_index;
-        if (p_ml->i_pos < 0 && p_ml->i_repeat == REPEAT_ALL)
-            p_ml->i_pos = media_list_get_count(p_ml) - 1;
-        p_ml->p_mi = p_ml->i_pos >= 0 ? eina_array_data_get(p_ml->p_item_array, p_ml->i_pos) : NULL;
-        media_list_on_new_pos(p_ml);
+        if (i_index < 0 && p_ml->i_repeat == REPEAT_ALL)
+            i_index = media_list_get_count(p_ml) - 1;
+        if (p_ml->b_shuffle && i_index >= 0)
+            ml_shuffle_selected(p_ml, ml_entry_at(p_ml, i_index));
+        media_list_select(p_ml, i_index);
         return true;
     } else {
         if (p_ml->i_repeat == REPEAT_ALL)
         {
-            p_ml->i_pos = 0;
-            p_ml->p_mi = eina_array_data_get(p_ml->p_item_array, p_ml->i_pos);
-            media_list_on_new_pos(p_ml);
+            if (p_ml->b_shuffle)
+                ml_shuffle_selected(p_ml, ml_entry_at(p_ml, 0));
+            media_list_select(p_ml, 0);
             return true;
         }
         return false;
@@ -309,12 +983,43 @@ media_list_set_next(media_list *p_ml)
     {
         return media_list_set_pos(p_ml, p_ml->i_pos);
     }
+    else if (p_ml->b_shuffle)
+    {
+        ml_entry *p_entry = ml_shuffle_peek_next(p_ml);
+        if (!p_entry)
+            return false;
+        ml_shuffle_set_history_pos(p_ml, p_entry->i_history);
+        media_list_select(p_ml, ml_entry_index(p_ml, p_entry));
+        return true;
+    }
     else
     {
         return media_list_set_pos(p_ml, p_ml->i_pos + 1);
     }
 }
 
+media_item *
+media_list_get_next_item(media_list *p_ml)
+{
+    unsigned int i_count = p_ml->i_count;
+
+    if (p_ml->i_pos < 0)
+        return NULL;
+    if (p_ml->i_repeat == REPEAT_ONE)
+        return p_ml->p_mi;
+    if (p_ml->b_shuffle)
+    {
+        /* Drawn now and kept in the history, so set_next will select it */
+        ml_entry *p_entry = ml_shuffle_peek_next(p_ml);
+        return p_entry ? p_entry->p_mi : NULL;
+    }
+    if ((unsigned int)p_ml->i_pos + 1 < i_count)
+        return ml_item_at(p_ml, p_ml->i_pos + 1);
+    if (p_ml->i_repeat == REPEAT_ALL && i_count > 0)
+        return ml_item_at(p_ml, 0);
+    return NULL;
+}
+
 bool
 media_list_set_prev(media_list *p_ml)
 {
@@ -322,6 +1027,15 @@ media_list_set_prev(media_list *p_ml)
     {
         return media_list_set_pos(p_ml, p_ml->i_pos);
     }
+    else if (p_ml->b_shuffle)
+    {
+        int i_prev = ml_shuffle_prev_pos(p_ml);
+        if (i_prev < 0)
+            return false;
+        ml_shuffle_set_history_pos(p_ml, i_prev);
+        media_list_select(p_ml, ml_entry_index(p_ml, eina_array_data_get(p_ml->p_history, i_prev)));
+        return true;
+    }
     else
     {
         return media_list_set_pos(p_ml, p_ml->i_pos - 1);
@@ -333,6 +1047,15 @@ media_list_has_next(media_list *p_ml)
 {
     if (p_ml->i_repeat != REPEAT_NONE)
         return true;
+    if (p_ml->b_shuffle)
+    {
+        if (p_ml->i_played < p_ml->i_count)
+            return true;
+        for (unsigned int i = p_ml->i_history_pos + 1; i < eina_array_count(p_ml->p_history); ++i)
+            if (eina_array_data_get(p_ml->p_history, i))
+                return true;
+        return false;
+    }
     if (media_list_get_pos(p_ml) + 1 >= media_list_get_count(p_ml))
         return false;
     return true;
@@ -343,6 +1066,8 @@ media_list_has_prev(media_list *p_ml)
 {
     if (p_ml->i_repeat != REPEAT_NONE)
         return true;
+    if (p_ml->b_shuffle)
+        return ml_shuffle_prev_pos(p_ml) >= 0;
     if (media_list_get_pos(p_ml) <= 0)
         return false;
     return true;
@@ -354,6 +1079,19 @@ media_list_get_item(media_list *p_ml)
     return p_ml->p_mi;
 }
 
+void
+media_list_replace_item(media_list *p_ml, unsigned int i_index, media_item *p_mi)
+{
+    ml_entry *p_entry = ml_entry_at(p_ml, i_index);
+    assert(p_entry);
+    media_item *p_old_mi = p_entry->p_mi;
+    p_entry->p_mi = p_mi;
+    if (p_ml->p_mi == p_old_mi && p_ml->i_pos == (int)i_index)
+        p_ml->p_mi = p_mi;
+    if (p_ml->b_free_media)
+        media_item_unref(p_old_mi);
+}
+
 media_item *
 media_list_get_item_at(media_list *p_ml, unsigned int i_index)
 {
@@ -361,7 +1099,7 @@ media_list_get_item_at(media_list *p_ml, unsigned int i_index)
 
     ML_CLIP_POS(i_index);
 
-    p_mi = eina_array_data_get(p_ml->p_item_array, i_index);
+    p_mi = ml_item_at(p_ml, i_index);
     assert(p_mi);
     return p_mi;
 }
@@ -378,6 +1116,26 @@ media_list_get_repeat_mode(media_list *p_ml)
     return p_ml->i_repeat;
 }
 
+void
+media_list_set_shuffle(media_list *p_ml, bool b_shuffle, uint64_t i_seed)
+{
+    p_ml->i_rand = i_seed;
+    p_ml->b_shuffle = b_shuffle;
+
+    /* The current media starts the order: it won't be played again before
+     * all the others */
+    if (b_shuffle)
+        ml_shuffle_new_cycle(p_ml, p_ml->i_pos >= 0 ? ml_entry_at(p_ml, p_ml->i_pos) : NULL);
+    else
+        ml_shuffle_reset(p_ml);
+}
+
+bool
+media_list_get_shuffle(media_list *p_ml)
+{
+    return p_ml->b_shuffle;
+}
+
 // Copy a media list src to a media list dst, removing any previous element in dst.
 int
 media_list_copy_list(media_list *p_ml_src, media_list *p_ml_dst)
@@ -396,7 +1154,7 @@ media_list_copy_list(media_list *p_ml_src, media_list *p_ml_dst)
         media_item *item = media_list_get_item_at(p_ml_src, i);
         if (item == NULL)
             return -1;
-        if (!media_list_insert(p_ml_dst, -1, media_item_copy(item)))
+        if (media_list_insert(p_ml_dst, -1, media_item_ref(item)) != 0)
             return -1;
     }
     return 0;
@@ -25,6 +25,8 @@
 #ifndef MEDIA_LIST_H
 #define MEDIA_LIST_H
 
+#include <stdint.h>
+
 #include "application.h"
 
 #include "media_item.h"
@@ -36,6 +38,13 @@ struct media_list_callbacks
     void (*pf_on_media_added)(media_list *p_ml, void *p_user_data, unsigned int i_pos, media_item *p_mi);
     void (*pf_on_media_removed)(media_list *p_ml, void *p_user_data, unsigned int i_pos, media_item *p_mi);
     void (*pf_on_media_selected)(media_list *p_ml, void *p_user_data, int i_pos, media_item *p_mi);
+    /* Called once before all the items are removed by media_list_clear. When
+     * NULL, pf_on_media_removed is called for each item instead. */
+    void (*pf_on_cleared)(media_list *p_ml, void *p_user_data, unsigned int i_count);
+    /* Called once for i_count items inserted at i_pos by
+     * media_list_insert_many or media_list_replace. When NULL,
+     * pf_on_media_added is called for each item instead. */
+    void (*pf_on_range_added)(media_list *p_ml, void *p_user_data, unsigned int i_pos, unsigned int i_count);
     void *p_user_data;
 };
 
@@ -60,12 +69,32 @@ media_list_unregister_callbacks(media_list *p_ml, media_list_cbs_id *p_id);
 int
 media_list_insert(media_list *p_ml, int i_index, media_item *p_mi);
 
+/*
+ * Inserts all the media_item of p_array at i_index (appends them if i_index
+ * is -1), with a single notification. The list takes ownership of the items,
+ * not of the array.
+ */
+int
+media_list_insert_many(media_list *p_ml, int i_index, Eina_Array *p_array);
+
+/*
+ * Replaces the whole list with the items of p_array and selects i_pos: one
+ * notification for the removals, one for the insertions and one for the
+ * selection, whatever the number of items.
+ */
+int
+media_list_replace(media_list *p_ml, Eina_Array *p_array, int i_pos);
+
 int
 media_list_remove(media_list *p_ml, media_item *p_mi);
 
 int
 media_list_remove_index(media_list *p_ml, unsigned int i_index);
 
+/* Moves the item at i_from to i_to, notified as a removal then an insertion */
+int
+media_list_move(media_list *p_ml, unsigned int i_from, unsigned int i_to);
+
 void
 media_list_clear(media_list *p_ml);
 
@@ -81,6 +110,10 @@ media_list_set_pos(media_list *p_ml, int i_index);
 bool
 media_list_set_next(media_list *p_ml);
 
+/* Returns the item media_list_set_next would select, or NULL if none */
+media_item *
+media_list_get_next_item(media_list *p_ml);
+
 bool
 media_list_set_prev(media_list *p_ml);
 
@@ -96,12 +129,32 @@ media_list_get_item(media_list *p_ml);
 media_item *
 media_list_get_item_at(media_list *p_ml,  unsigned int i_index);
 
+/*
+ * Replaces the item at i_index with p_mi, for instance with a modified copy
+ * of it, without notifying a removal and an insertion. The list takes
+ * ownership of p_mi.
+ */
+void
+media_list_replace_item(media_list *p_ml, unsigned int i_index, media_item *p_mi);
+
 void
 media_list_set_repeat_mode(media_list *p_ml, enum PLAYLIST_REPEAT i_repeat);
 
 enum PLAYLIST_REPEAT
 media_list_get_repeat_mode(media_list *p_ml);
 
+/*
+ * In shuffle mode, next and prev follow a random order where every item is
+ * played once per cycle. The order is generated lazily from i_seed, and
+ * survives items being added, removed or moved. Enabling it starts a new
+ * cycle from the current item.
+ */
+void
+media_list_set_shuffle(media_list *p_ml, bool b_shuffle, uint64_t i_seed);
+
+bool
+media_list_get_shuffle(media_list *p_ml);
+
 int
 media_list_copy_list(media_list *p_ml_src, media_list *p_ml_dst);
 
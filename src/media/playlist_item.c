@@ -59,6 +59,13 @@ playlist_item_identical(const playlist_item* p_left, const playlist_item* p_righ
     return p_left->i_id == p_right->i_id;
 }
 
+bool
+playlist_item_equals(const playlist_item* p_left, const playlist_item* p_right)
+{
+    return p_left->i_id == p_right->i_id &&
+            library_item_str_equals(p_left->psz_name, p_right->psz_name);
+}
+
 void
 playlist_item_destroy(playlist_item* p_item)
 {
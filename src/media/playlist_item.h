@@ -36,7 +36,6 @@ extern "C" {
 typedef struct playlist_item {
     LIBRARY_ITEM_COMMON
 
-    int64_t i_id;
     char* psz_name;
 } playlist_item;
 
@@ -49,6 +48,10 @@ playlist_item_copy( const playlist_item* p_item );
 bool
 playlist_item_identical( const playlist_item* p_left, const playlist_item* p_right);
 
+/* Returns true if both items hold the exact same content */
+bool
+playlist_item_equals( const playlist_item* p_left, const playlist_item* p_right );
+
 void
 playlist_item_destroy( playlist_item* p_item );
 
@@ -0,0 +1,798 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+
+#include "common.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "media/media_item.h"
+#include "queue_store.h"
+
+#define QUEUE_FILE_MAGIC    0x51434c56  /* "VLCQ" */
+#define QUEUE_FILE_VERSION  1
+
+/* Changes are saved in a batch once the queues are left alone that long */
+#define QUEUE_FLUSH_DELAY   5.0
+
+/*
+ * The files are only read back by the same device: records are written in
+ * the native layout, the version being bumped whenever one of them changes.
+ * Strings are stored with their terminating NUL, their size being 0 for NULL.
+ */
+typedef struct queue_file_header
+{
+    uint32_t i_magic;
+    uint32_t i_version;
+    uint32_t i_count;           /* items, or queues for the state file */
+} queue_file_header;
+
+typedef struct queue_item_record
+{
+    int64_t i_id;
+    int64_t i_duration;
+    int32_t i_type;
+    int32_t i_w, i_h;
+    uint32_t i_track_number;
+    /* followed by the path, the snapshot and the metas */
+} queue_item_record;
+
+typedef struct queue_state_record
+{
+    int32_t i_pos;
+    int32_t i_repeat;
+    int32_t b_shuffle;
+    int32_t i_reserved;
+    double f_time;
+} queue_state_record;
+
+typedef struct queue_entry
+{
+    media_list *p_ml;
+    media_list_cbs_id *p_cbs_id;
+    bool b_dirty;               /* items changed since the last snapshot */
+    double f_time;
+} queue_entry;
+
+/* A snapshot to write, or the result of a restore */
+typedef struct queue_batch
+{
+    queue_store *p_store;
+    char *psz_dir;
+    unsigned int i_generation;
+    unsigned int i_queues;
+    queue_store_state *p_states;
+    Eina_Array **pp_items;      /* referenced items, NULL when unchanged */
+
+    queue_store_restored_cb pf_restored;
+    void *p_user_data;
+} queue_batch;
+
+struct queue_store
+{
+    char *psz_dir;
+    queue_entry *p_queues;
+    unsigned int i_queues;
+
+    Ecore_Timer *p_flush_timer;
+    Ecore_Thread *p_thread;     /* writing or restoring */
+    bool b_restoring;
+    bool b_flush_again;         /* flush requested while a thread was running */
+    bool b_destroyed;           /* freed by the running thread when it ends */
+
+    /* Writes are serialized by the lock, and an older batch never
+     * overwrites a newer one */
+    Eina_Lock lock;
+    unsigned int i_generation;
+    unsigned int i_written;     /* under lock */
+};
+
+/****************/
+/* file helpers */
+/****************/
+
+static char *
+queue_file_path(const char *psz_dir, unsigned int i_queue, bool b_state)
+{
+    char *psz_path;
+    int i_ret = b_state ? asprintf(&psz_path, "%s/queue_state.bin", psz_dir)
+                        : asprintf(&psz_path, "%s/queue_%u.bin", psz_dir, i_queue);
+    return i_ret >= 0 ? psz_path : NULL;
+}
+
+static bool
+queue_file_write_str(FILE *p_file, const char *psz)
+{
+    uint32_t i_size = psz ? strlen(psz) + 1 : 0;
+
+    return fwrite(&i_size, sizeof(i_size), 1, p_file) == 1 &&
+           (i_size == 0 || fwrite(psz, i_size, 1, p_file) == 1);
+}
+
+/* Writes to a temporary file first, so that a kill never leaves a
+ * truncated snapshot behind */
+static FILE *
+queue_file_open(const char *psz_path, char **ppsz_tmp)
+{
+    if (asprintf(ppsz_tmp, "%s.tmp", psz_path) < 0)
+        return NULL;
+
+    FILE *p_file = fopen(*ppsz_tmp, "wb");
+    if (!p_file)
+    {
+        LOGE("queue_store: unable to create %s", *ppsz_tmp);
+        free(*ppsz_tmp);
+        return NULL;
+    }
+    return p_file;
+}
+
+static void
+queue_file_close(FILE *p_file, char *psz_tmp, const char *psz_path, bool b_ok)
+{
+    if (fclose(p_file) != 0)
+        b_ok = false;
+    if (!b_ok || rename(psz_tmp, psz_path) != 0)
+    {
+        LOGE("queue_store: unable to write %s", psz_path);
+        unlink(psz_tmp);
+    }
+    free(psz_tmp);
+}
+
+static void
+queue_file_write_items(const char *psz_path, Eina_Array *p_items)
+{
+    char *psz_tmp;
+    FILE *p_file = queue_file_open(psz_path, &psz_tmp);
+    if (!p_file)
+        return;
+
+    queue_file_header header = {
+        .i_magic = QUEUE_FILE_MAGIC,
+        .i_version = QUEUE_FILE_VERSION,
+        .i_count = eina_array_count(p_items),
+    };
+    bool b_ok = fwrite(&header, sizeof(header), 1, p_file) == 1;
+
+    for (unsigned int i = 0; b_ok && i < header.i_count; ++i)
+    {
+        const media_item *p_mi = eina_array_data_get(p_items, i);
+        queue_item_record record = {
+            .i_id = p_mi->i_id,
+            .i_duration = p_mi->i_duration,
+            .i_type = p_mi->i_type,
+            .i_w = p_mi->i_w,
+            .i_h = p_mi->i_h,
+            .i_track_number = p_mi->i_track_number,
+        };
+
+        b_ok = fwrite(&record, sizeof(record), 1, p_file) == 1 &&
+               queue_file_write_str(p_file, p_mi->psz_path) &&
+               queue_file_write_str(p_file, p_mi->psz_snapshot);
+        for (unsigned int j = 0; b_ok && j < MEDIA_ITEM_META_COUNT; ++j)
+            b_ok = queue_file_write_str(p_file, p_mi->psz_metas[j]);
+    }
+
+    queue_file_close(p_file, psz_tmp, psz_path, b_ok);
+}
+
+static void
+queue_file_write_states(const char *psz_path, const queue_store_state *p_states,
+                        unsigned int i_queues)
+{
+    char *psz_tmp;
+    FILE *p_file = queue_file_open(psz_path, &psz_tmp);
+    if (!p_file)
+        return;
+
+    queue_file_header header = {
+        .i_magic = QUEUE_FILE_MAGIC,
+        .i_version = QUEUE_FILE_VERSION,
+        .i_count = i_queues,
+    };
+    bool b_ok = fwrite(&header, sizeof(header), 1, p_file) == 1;
+
+    for (unsigned int i = 0; b_ok && i < i_queues; ++i)
+    {
+        queue_state_record record = {
+            .i_pos = p_states[i].i_pos,
+            .i_repeat = p_states[i].i_repeat,
+            .b_shuffle = p_states[i].b_shuffle,
+            .f_time = p_states[i].f_time,
+        };
+        b_ok = fwrite(&record, sizeof(record), 1, p_file) == 1;
+    }
+
+    queue_file_close(p_file, psz_tmp, psz_path, b_ok);
+}
+
+/* Reads the whole file, which is then parsed from memory */
+static char *
+queue_file_load(const char *psz_path, size_t *pi_size)
+{
+    FILE *p_file = fopen(psz_path, "rb");
+    if (!p_file)
+        return NULL;
+
+    char *p_data = NULL;
+    long i_size;
+    if (fseek(p_file, 0, SEEK_END) == 0 && (i_size = ftell(p_file)) > 0 &&
+        fseek(p_file, 0, SEEK_SET) == 0 && (p_data = malloc(i_size)) != NULL)
+    {
+        if (fread(p_data, i_size, 1, p_file) == 1)
+            *pi_size = i_size;
+        else
+        {
+            free(p_data);
+            p_data = NULL;
+        }
+    }
+    fclose(p_file);
+    return p_data;
+}
+
+typedef struct queue_reader
+{
+    const char *p_cur;
+    const char *p_end;
+} queue_reader;
+
+static bool
+queue_read(queue_reader *p_reader, void *p_dst, size_t i_size)
+{
+    if ((size_t)(p_reader->p_end - p_reader->p_cur) < i_size)
+        return false;
+    memcpy(p_dst, p_reader->p_cur, i_size);
+    p_reader->p_cur += i_size;
+    return true;
+}
+
+/* Points into the loaded file */
+static bool
+queue_read_str(queue_reader *p_reader, const char **ppsz)
+{
+    uint32_t i_size;
+
+    if (!queue_read(p_reader, &i_size, sizeof(i_size)) ||
+        (size_t)(p_reader->p_end - p_reader->p_cur) < i_size ||
+        (i_size > 0 && p_reader->p_cur[i_size - 1] != '\0'))
+        return false;
+    *ppsz = i_size > 0 ? p_reader->p_cur : NULL;
+    p_reader->p_cur += i_size;
+    return true;
+}
+
+static bool
+queue_read_header(queue_reader *p_reader, queue_file_header *p_header)
+{
+    return queue_read(p_reader, p_header, sizeof(*p_header)) &&
+           p_header->i_magic == QUEUE_FILE_MAGIC &&
+           p_header->i_version == QUEUE_FILE_VERSION;
+}
+
+static media_item *
+queue_read_item(queue_reader *p_reader)
+{
+    queue_item_record record;
+    const char *psz_path, *psz_snapshot, *ppsz_metas[MEDIA_ITEM_META_COUNT];
+
+    if (!queue_read(p_reader, &record, sizeof(record)) ||
+        !queue_read_str(p_reader, &psz_path) ||
+        !queue_read_str(p_reader, &psz_snapshot))
+        return NULL;
+    for (unsigned int i = 0; i < MEDIA_ITEM_META_COUNT; ++i)
+        if (!queue_read_str(p_reader, &ppsz_metas[i]))
+            return NULL;
+    if (!psz_path)
+        return NULL;
+
+    media_item *p_mi = media_item_create(psz_path, record.i_type);
+    if (!p_mi)
+        return NULL;
+    p_mi->i_id = record.i_id;
+    p_mi->i_duration = record.i_duration;
+    p_mi->i_w = record.i_w;
+    p_mi->i_h = record.i_h;
+    p_mi->i_track_number = record.i_track_number;
+    if (psz_snapshot)
+        media_item_set_snapshot(p_mi, psz_snapshot);
+    for (unsigned int i = 0; i < MEDIA_ITEM_META_COUNT; ++i)
+        if (ppsz_metas[i])
+            media_item_set_meta(p_mi, i, ppsz_metas[i]);
+    return p_mi;
+}
+
+static Eina_Array *
+queue_file_read_items(const char *psz_path)
+{
+    size_t i_size;
+    char *p_data = queue_file_load(psz_path, &i_size);
+    if (!p_data)
+        return NULL;
+
+    queue_reader reader = { p_data, p_data + i_size };
+    queue_file_header header;
+    Eina_Array *p_items = NULL;
+
+    if (queue_read_header(&reader, &header) && header.i_count > 0 &&
+        (p_items = eina_array_new(header.i_count)) != NULL)
+    {
+        for (unsigned int i = 0; i < header.i_count; ++i)
+        {
+            media_item *p_mi = queue_read_item(&reader);
+            if (!p_mi)
+            {
+                /* Keep what could be read of a damaged file */
+                LOGE("queue_store: %s is truncated after %u items", psz_path, i);
+                break;
+            }
+            if (!eina_array_push(p_items, p_mi))
+            {
+                media_item_unref(p_mi);
+                break;
+            }
+        }
+    }
+    free(p_data);
+    return p_items;
+}
+
+static bool
+queue_file_read_states(const char *psz_path, queue_store_state *p_states,
+                       unsigned int i_queues)
+{
+    size_t i_size;
+    char *p_data = queue_file_load(psz_path, &i_size);
+    if (!p_data)
+        return false;
+
+    queue_reader reader = { p_data, p_data + i_size };
+    queue_file_header header;
+    bool b_ok = queue_read_header(&reader, &header);
+
+    for (unsigned int i = 0; b_ok && i < header.i_count && i < i_queues; ++i)
+    {
+        queue_state_record record;
+        b_ok = queue_read(&reader, &record, sizeof(record));
+        if (b_ok)
+        {
+            p_states[i].i_pos = record.i_pos;
+            p_states[i].i_repeat = record.i_repeat;
+            p_states[i].b_shuffle = record.b_shuffle != 0;
+            p_states[i].f_time = record.f_time;
+        }
+    }
+    free(p_data);
+    return b_ok;
+}
+
+/***********/
+/* batches */
+/***********/
+
+static queue_batch *
+queue_batch_create(queue_store *p_store)
+{
+    queue_batch *p_batch = calloc(1, sizeof(*p_batch));
+    if (!p_batch)
+        return NULL;
+    p_batch->p_store = p_store;
+    p_batch->i_queues = p_store->i_queues;
+    p_batch->psz_dir = strdup(p_store->psz_dir);
+    p_batch->p_states = calloc(p_store->i_queues, sizeof(*p_batch->p_states));
+    p_batch->pp_items = calloc(p_store->i_queues, sizeof(*p_batch->pp_items));
+    if (!p_batch->psz_dir || !p_batch->p_states || !p_batch->pp_items)
+    {
+        free(p_batch->psz_dir);
+        free(p_batch->p_states);
+        free(p_batch->pp_items);
+        free(p_batch);
+        return NULL;
+    }
+    return p_batch;
+}
+
+/* Must be called from the main loop, since it releases the items */
+static void
+queue_batch_destroy(queue_batch *p_batch)
+{
+    for (unsigned int i = 0; i < p_batch->i_queues; ++i)
+    {
+        Eina_Array *p_items = p_batch->pp_items[i];
+        if (!p_items)
+            continue;
+        for (unsigned int j = 0; j < eina_array_count(p_items); ++j)
+            media_item_unref(eina_array_data_get(p_items, j));
+        eina_array_free(p_items);
+    }
+    free(p_batch->psz_dir);
+    free(p_batch->p_states);
+    free(p_batch->pp_items);
+    free(p_batch);
+}
+
+/*
+ * Takes a snapshot of the queues: the states, and the items of the queues
+ * that changed. Only references are taken there, the items being immutable
+ * once shared, so that it stays cheap for long queues.
+ */
+static queue_batch *
+queue_batch_snapshot(queue_store *p_store)
+{
+    queue_batch *p_batch = queue_batch_create(p_store);
+    if (!p_batch)
+        return NULL;
+    p_batch->i_generation = ++p_store->i_generation;
+
+    for (unsigned int i = 0; i < p_store->i_queues; ++i)
+    {
+        queue_entry *p_queue = &p_store->p_queues[i];
+        queue_store_state *p_state = &p_batch->p_states[i];
+
+        if (!p_queue->p_ml)
+        {
+            p_state->i_pos = -1;
+            continue;
+        }
+        p_state->i_pos = media_list_get_pos(p_queue->p_ml);
+        p_state->i_repeat = media_list_get_repeat_mode(p_queue->p_ml);
+        p_state->b_shuffle = media_list_get_shuffle(p_queue->p_ml);
+        p_state->f_time = p_queue->f_time;
+
+        if (!p_queue->b_dirty)
+            continue;
+
+        unsigned int i_count = media_list_get_count(p_queue->p_ml);
+        Eina_Array *p_items = eina_array_new(i_count > 0 ? i_count : 1);
+        if (!p_items)
+            continue;
+        for (unsigned int j = 0; j < i_count; ++j)
+        {
+            media_item *p_mi = media_list_get_item_at(p_queue->p_ml, j);
+            if (!eina_array_push(p_items, p_mi))
+                break;
+            media_item_ref(p_mi);
+        }
+        p_batch->pp_items[i] = p_items;
+        p_queue->b_dirty = false;
+    }
+    return p_batch;
+}
+
+static void
+queue_batch_write(queue_batch *p_batch)
+{
+    queue_store *p_store = p_batch->p_store;
+
+    eina_lock_take(&p_store->lock);
+    if (p_batch->i_generation > p_store->i_written)
+    {
+        for (unsigned int i = 0; i < p_batch->i_queues; ++i)
+        {
+            if (!p_batch->pp_items[i])
+                continue;
+            char *psz_path = queue_file_path(p_batch->psz_dir, i, false);
+            if (psz_path)
+            {
+                queue_file_write_items(psz_path, p_batch->pp_items[i]);
+                free(psz_path);
+            }
+        }
+
+        /* Written last, so that it never refers to items not saved yet */
+        char *psz_path = queue_file_path(p_batch->psz_dir, 0, true);
+        if (psz_path)
+        {
+            queue_file_write_states(psz_path, p_batch->p_states, p_batch->i_queues);
+            free(psz_path);
+        }
+        p_store->i_written = p_batch->i_generation;
+    }
+    eina_lock_release(&p_store->lock);
+}
+
+static void
+queue_batch_read(queue_batch *p_batch)
+{
+    char *psz_path = queue_file_path(p_batch->psz_dir, 0, true);
+    if (!psz_path)
+        return;
+    bool b_ok = queue_file_read_states(psz_path, p_batch->p_states, p_batch->i_queues);
+    free(psz_path);
+    if (!b_ok)
+        return;
+
+    for (unsigned int i = 0; i < p_batch->i_queues; ++i)
+    {
+        if (p_batch->p_states[i].i_pos < 0)
+            continue;
+        psz_path = queue_file_path(p_batch->psz_dir, i, false);
+        if (psz_path)
+        {
+            p_batch->pp_items[i] = queue_file_read_items(psz_path);
+            free(psz_path);
+        }
+    }
+}
+
+/*********/
+/* store */
+/*********/
+
+static void
+queue_store_free(queue_store *p_store)
+{
+    eina_lock_free(&p_store->lock);
+    free(p_store->p_queues);
+    free(p_store->psz_dir);
+    free(p_store);
+}
+
+static void
+queue_thread_run_cb(void *data, Ecore_Thread *thread)
+{
+    queue_batch *p_batch = data;
+
+    if (p_batch->pf_restored)
+        queue_batch_read(p_batch);
+    else
+        queue_batch_write(p_batch);
+}
+
+static void
+queue_thread_end_cb(void *data, Ecore_Thread *thread)
+{
+    queue_batch *p_batch = data;
+    queue_store *p_store = p_batch->p_store;
+
+    p_store->p_thread = NULL;
+
+    if (p_batch->pf_restored && !p_store->b_destroyed)
+    {
+        p_store->b_restoring = false;
+        for (unsigned int i = 0; i < p_batch->i_queues; ++i)
+        {
+            Eina_Array *p_items = p_batch->pp_items[i];
+            if (!p_items || eina_array_count(p_items) == 0)
+                continue;
+
+            /* The items now belong to the callback */
+            p_batch->pp_items[i] = NULL;
+            bool b_adopted = p_batch->pf_restored(p_batch->p_user_data, i, p_items,
+                                                  &p_batch->p_states[i]);
+            eina_array_free(p_items);
+            if (!b_adopted)
+                continue;
+
+            /* Restoring the list isn't a change to save */
+            p_store->p_queues[i].b_dirty = false;
+            p_store->p_queues[i].f_time = p_batch->p_states[i].f_time;
+        }
+    }
+    queue_batch_destroy(p_batch);
+
+    if (p_store->b_destroyed)
+    {
+        queue_store_free(p_store);
+        return;
+    }
+    if (p_store->b_flush_again)
+    {
+        p_store->b_flush_again = false;
+        queue_store_flush(p_store);
+    }
+}
+
+queue_store *
+queue_store_create(const char *psz_dir, unsigned int i_queues)
+{
+    queue_store *p_store = calloc(1, sizeof(*p_store));
+    if (!p_store)
+        return NULL;
+
+    if (!eina_lock_new(&p_store->lock))
+    {
+        free(p_store);
+        return NULL;
+    }
+    p_store->psz_dir = strdup(psz_dir);
+    p_store->p_queues = calloc(i_queues, sizeof(*p_store->p_queues));
+    p_store->i_queues = i_queues;
+    if (!p_store->psz_dir || !p_store->p_queues)
+    {
+        queue_store_free(p_store);
+        return NULL;
+    }
+    return p_store;
+}
+
+void
+queue_store_destroy(queue_store *p_store)
+{
+    /* The queues weren't restored yet: writing them would lose them */
+    if (!p_store->b_restoring)
+    {
+        queue_batch *p_batch = queue_batch_snapshot(p_store);
+        if (p_batch)
+        {
+            queue_batch_write(p_batch);
+            queue_batch_destroy(p_batch);
+        }
+    }
+
+    if (p_store->p_flush_timer)
+        ecore_timer_del(p_store->p_flush_timer);
+
+    for (unsigned int i = 0; i < p_store->i_queues; ++i)
+    {
+        queue_entry *p_queue = &p_store->p_queues[i];
+        if (p_queue->p_cbs_id)
+            media_list_unregister_callbacks(p_queue->p_ml, p_queue->p_cbs_id);
+        p_queue->p_ml = NULL;
+    }
+
+    if (p_store->p_thread)
+        p_store->b_destroyed = true;
+    else
+        queue_store_free(p_store);
+}
+
+static Eina_Bool
+queue_flush_timer_cb(void *data)
+{
+    queue_store *p_store = data;
+
+    p_store->p_flush_timer = NULL;
+    queue_store_flush(p_store);
+    return ECORE_CALLBACK_CANCEL;
+}
+
+static void
+queue_schedule_flush(queue_store *p_store)
+{
+    if (p_store->p_flush_timer)
+        ecore_timer_reset(p_store->p_flush_timer);
+    else
+        p_store->p_flush_timer = ecore_timer_add(QUEUE_FLUSH_DELAY, queue_flush_timer_cb, p_store);
+}
+
+static void
+queue_ml_on_changed(queue_store *p_store, media_list *p_ml)
+{
+    for (unsigned int i = 0; i < p_store->i_queues; ++i)
+    {
+        if (p_store->p_queues[i].p_ml == p_ml)
+        {
+            p_store->p_queues[i].b_dirty = true;
+            queue_schedule_flush(p_store);
+            return;
+        }
+    }
+}
+
+static void
+queue_ml_on_media_added_cb(media_list *p_ml, void *p_user_data, unsigned int i_pos, media_item *p_mi)
+{
+    queue_ml_on_changed(p_user_data, p_ml);
+}
+
+static void
+queue_ml_on_media_removed_cb(media_list *p_ml, void *p_user_data, unsigned int i_pos, media_item *p_mi)
+{
+    queue_ml_on_changed(p_user_data, p_ml);
+}
+
+static void
+queue_ml_on_cleared_cb(media_list *p_ml, void *p_user_data, unsigned int i_count)
+{
+    queue_ml_on_changed(p_user_data, p_ml);
+}
+
+static void
+queue_ml_on_range_added_cb(media_list *p_ml, void *p_user_data, unsigned int i_pos, unsigned int i_count)
+{
+    queue_ml_on_changed(p_user_data, p_ml);
+}
+
+static void
+queue_ml_on_media_selected_cb(media_list *p_ml, void *p_user_data, int i_pos, media_item *p_mi)
+{
+    queue_store *p_store = p_user_data;
+
+    for (unsigned int i = 0; i < p_store->i_queues; ++i)
+    {
+        if (p_store->p_queues[i].p_ml == p_ml)
+        {
+            p_store->p_queues[i].f_time = 0.0;
+            queue_schedule_flush(p_store);
+            return;
+        }
+    }
+}
+
+int
+queue_store_attach(queue_store *p_store, unsigned int i_queue, media_list *p_ml)
+{
+    media_list_callbacks cbs = {
+        .pf_on_media_added = queue_ml_on_media_added_cb,
+        .pf_on_media_removed = queue_ml_on_media_removed_cb,
+        .pf_on_media_selected = queue_ml_on_media_selected_cb,
+        .pf_on_cleared = queue_ml_on_cleared_cb,
+        .pf_on_range_added = queue_ml_on_range_added_cb,
+        .p_user_data = p_store,
+    };
+    queue_entry *p_queue = &p_store->p_queues[i_queue];
+
+    assert(i_queue < p_store->i_queues && p_queue->p_ml == NULL);
+    p_queue->p_cbs_id = media_list_register_callbacks(p_ml, &cbs);
+    if (!p_queue->p_cbs_id)
+        return -1;
+    p_queue->p_ml = p_ml;
+    return 0;
+}
+
+void
+queue_store_set_time(queue_store *p_store, unsigned int i_queue, double f_time)
+{
+    assert(i_queue < p_store->i_queues);
+    p_store->p_queues[i_queue].f_time = f_time;
+}
+
+void
+queue_store_flush(queue_store *p_store)
+{
+    /* A single thread runs at a time, and the restore goes first */
+    if (p_store->p_thread || p_store->b_restoring)
+    {
+        p_store->b_flush_again = true;
+        return;
+    }
+
+    queue_batch *p_batch = queue_batch_snapshot(p_store);
+    if (!p_batch)
+        return;
+
+    p_store->p_thread = ecore_thread_run(queue_thread_run_cb, queue_thread_end_cb,
+                                         queue_thread_end_cb, p_batch);
+}
+
+void
+queue_store_restore(queue_store *p_store, queue_store_restored_cb pf_restored, void *p_user_data)
+{
+    if (p_store->p_thread || p_store->b_restoring)
+        return;
+
+    queue_batch *p_batch = queue_batch_create(p_store);
+    if (!p_batch)
+        return;
+    p_batch->pf_restored = pf_restored;
+    p_batch->p_user_data = p_user_data;
+
+    p_store->b_restoring = true;
+    p_store->p_thread = ecore_thread_run(queue_thread_run_cb, queue_thread_end_cb,
+                                         queue_thread_end_cb, p_batch);
+}
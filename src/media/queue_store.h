@@ -0,0 +1,83 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+
+#ifndef QUEUE_STORE_H
+#define QUEUE_STORE_H
+
+#include "media/media_list.h"
+
+typedef struct queue_store queue_store;
+
+typedef struct queue_store_state
+{
+    int i_pos;
+    enum PLAYLIST_REPEAT i_repeat;
+    bool b_shuffle;
+    double f_time;              /* in the current media, in seconds */
+} queue_store_state;
+
+/*
+ * Restored items are given to the callback, which owns them. The array
+ * itself belongs to the store. Called from the main loop.
+ * Returns false if the queue wasn't replaced by the restored one, which then
+ * keeps its pending changes.
+ */
+typedef bool (*queue_store_restored_cb)(void *p_user_data, unsigned int i_queue,
+                                        Eina_Array *p_items, const queue_store_state *p_state);
+
+/*
+ * Saves i_queues play queues to binary snapshots in psz_dir: one file per
+ * queue for its items, only rewritten when they changed, and a small one for
+ * the positions, repeat and shuffle modes, and times.
+ */
+queue_store *
+queue_store_create(const char *psz_dir, unsigned int i_queues);
+
+/* Writes the changes synchronously, then frees the store. Must be called
+ * before the attached lists are destroyed */
+void
+queue_store_destroy(queue_store *p_store);
+
+/* Tracks the changes of p_ml, saved as the queue i_queue */
+int
+queue_store_attach(queue_store *p_store, unsigned int i_queue, media_list *p_ml);
+
+/* Time in the current media of the queue. Reset when another one is selected */
+void
+queue_store_set_time(queue_store *p_store, unsigned int i_queue, double f_time);
+
+/* Writes the snapshots in a background thread */
+void
+queue_store_flush(queue_store *p_store);
+
+/*
+ * Reads the snapshots in a background thread, the items being created
+ * there too, then calls pf_restored for each saved queue that isn't empty.
+ * Flushes are delayed until the queues are restored.
+ */
+void
+queue_store_restore(queue_store *p_store, queue_store_restored_cb pf_restored, void *p_user_data);
+
+#endif /* QUEUE_STORE_H */
@@ -0,0 +1,398 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+
+#include "common.h"
+
+#include <sqlite3.h>
+
+#include "resume_store.h"
+
+/* Positions this close to the start of a media aren't worth resuming */
+#define RESUME_MARGIN 5.0
+
+/* Milliseconds to wait for the database to be unlocked */
+#define RESUME_DB_BUSY_TIMEOUT 1000
+
+typedef struct resume_write
+{
+    char *psz_mrl;
+    double f_time;          /* < 0 to delete the entry */
+} resume_write;
+
+typedef struct resume_batch
+{
+    resume_store *p_store;
+    char *psz_db_path;
+    resume_write *p_writes;
+    unsigned int i_count;
+    unsigned int i_generation;
+} resume_batch;
+
+struct resume_store
+{
+    char *psz_db_path;
+    Eina_Hash *p_positions;     /* mrl -> double*, the current positions */
+    Eina_Hash *p_dirty;         /* mrl -> double*, changed since the last flush */
+
+    Ecore_Thread *p_flush_thread;
+    resume_batch *p_flush_batch;    /* batch of the running thread */
+    bool b_flush_again;         /* flush requested while a batch was running */
+    bool b_destroyed;           /* freed by the running batch when it ends */
+
+    /* Writes are serialized by the lock, and a batch that was included in a
+     * newer write is skipped */
+    Eina_Lock lock;
+    unsigned int i_generation;
+    unsigned int i_written;     /* under lock */
+};
+
+static bool
+resume_db_prepare(sqlite3 *db)
+{
+    char *error;
+    const char* req = "CREATE TABLE IF NOT EXISTS resume_positions (" \
+            "MRL TEXT PRIMARY KEY NOT NULL," \
+            "Position REAL NOT NULL" \
+            ");";
+
+    if (sqlite3_exec(db, req, NULL, NULL, &error) != SQLITE_OK)
+    {
+        LOGE("SQL Error: %s", error);
+        sqlite3_free(error);
+        return false;
+    }
+    return true;
+}
+
+static void
+resume_db_write(const char *psz_db_path, const resume_write *p_writes, unsigned int i_count)
+{
+    sqlite3 *db;
+    sqlite3_stmt *p_set = NULL, *p_del = NULL;
+
+    if (sqlite3_open(psz_db_path, &db) != SQLITE_OK)
+    {
+        LOGE("Unable to open the resume database");
+        sqlite3_close(db);
+        return;
+    }
+    sqlite3_busy_timeout(db, RESUME_DB_BUSY_TIMEOUT);
+    if (!resume_db_prepare(db))
+        goto end;
+
+    if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO resume_positions(MRL, Position) VALUES(?, ?)",
+                           -1, &p_set, NULL) != SQLITE_OK ||
+        sqlite3_prepare_v2(db, "DELETE FROM resume_positions WHERE MRL = ?",
+                           -1, &p_del, NULL) != SQLITE_OK)
+    {
+        LOGE("SQL Error: %s", sqlite3_errmsg(db));
+        goto end;
+    }
+
+    sqlite3_exec(db, "BEGIN", NULL, NULL, NULL);
+    for (unsigned int i = 0; i < i_count; ++i)
+    {
+        sqlite3_stmt *p_stmt = p_writes[i].f_time < 0 ? p_del : p_set;
+
+        sqlite3_bind_text(p_stmt, 1, p_writes[i].psz_mrl, -1, SQLITE_STATIC);
+        if (p_stmt == p_set)
+            sqlite3_bind_double(p_stmt, 2, p_writes[i].f_time);
+        if (sqlite3_step(p_stmt) != SQLITE_DONE)
+            LOGE("SQL Error: %s", sqlite3_errmsg(db));
+        sqlite3_reset(p_stmt);
+    }
+    if (sqlite3_exec(db, "COMMIT", NULL, NULL, NULL) != SQLITE_OK)
+        LOGE("SQL Error: %s", sqlite3_errmsg(db));
+
+end:
+    sqlite3_finalize(p_set);
+    sqlite3_finalize(p_del);
+    sqlite3_close(db);
+}
+
+static int
+resume_db_load_cb(void *data, int argc, char **argv, char **column)
+{
+    resume_store *p_store = data;
+
+    if (argc < 2 || argv[0] == NULL || argv[1] == NULL)
+        return 0;
+
+    double *p_time = malloc(sizeof(*p_time));
+    if (p_time == NULL)
+        return 0;
+    *p_time = atof(argv[1]);
+    eina_hash_set(p_store->p_positions, argv[0], p_time);
+    return 0;
+}
+
+resume_store *
+resume_store_create(const char *psz_db_path)
+{
+    sqlite3 *db;
+    char *error;
+
+    resume_store *p_store = calloc(1, sizeof(*p_store));
+    if (p_store == NULL)
+        return NULL;
+
+    if (!eina_lock_new(&p_store->lock))
+    {
+        free(p_store);
+        return NULL;
+    }
+    p_store->psz_db_path = strdup(psz_db_path);
+    p_store->p_positions = eina_hash_string_superfast_new(free);
+    p_store->p_dirty = eina_hash_string_superfast_new(free);
+    if (!p_store->psz_db_path || !p_store->p_positions || !p_store->p_dirty)
+    {
+        resume_store_destroy(p_store);
+        return NULL;
+    }
+
+    /* The table is small: load it once, lookups are then done in memory */
+    if (sqlite3_open(psz_db_path, &db) == SQLITE_OK && resume_db_prepare(db))
+    {
+        if (sqlite3_exec(db, "SELECT MRL, Position FROM resume_positions",
+                         resume_db_load_cb, p_store, &error) != SQLITE_OK)
+        {
+            LOGE("SQL Error: %s", error);
+            sqlite3_free(error);
+        }
+    }
+    else
+        LOGE("Unable to open the resume database");
+    sqlite3_close(db);
+
+    return p_store;
+}
+
+static Eina_Bool
+resume_batch_fill_cb(const Eina_Hash *hash, const void *key, void *data, void *fdata)
+{
+    resume_batch *p_batch = fdata;
+    resume_write *p_write = &p_batch->p_writes[p_batch->i_count];
+
+    p_write->psz_mrl = strdup(key);
+    if (p_write->psz_mrl == NULL)
+        return EINA_TRUE;
+    p_write->f_time = *(double *) data;
+    p_batch->i_count++;
+    return EINA_TRUE;
+}
+
+/* Moves the dirty positions into a batch owned by the caller */
+static resume_batch *
+resume_batch_create(resume_store *p_store)
+{
+    int i_count = eina_hash_population(p_store->p_dirty);
+    if (i_count <= 0)
+        return NULL;
+
+    resume_batch *p_batch = calloc(1, sizeof(*p_batch));
+    if (p_batch == NULL)
+        return NULL;
+    p_batch->p_writes = calloc(i_count, sizeof(resume_write));
+    p_batch->psz_db_path = strdup(p_store->psz_db_path);
+    if (p_batch->p_writes == NULL || p_batch->psz_db_path == NULL)
+    {
+        free(p_batch->p_writes);
+        free(p_batch->psz_db_path);
+        free(p_batch);
+        return NULL;
+    }
+    p_batch->p_store = p_store;
+    p_batch->i_generation = ++p_store->i_generation;
+
+    eina_hash_foreach(p_store->p_dirty, resume_batch_fill_cb, p_batch);
+    eina_hash_free_buckets(p_store->p_dirty);
+    return p_batch;
+}
+
+static void
+resume_batch_destroy(resume_batch *p_batch)
+{
+    for (unsigned int i = 0; i < p_batch->i_count; ++i)
+        free(p_batch->p_writes[i].psz_mrl);
+    free(p_batch->p_writes);
+    free(p_batch->psz_db_path);
+    free(p_batch);
+}
+
+static void
+resume_batch_write(resume_batch *p_batch)
+{
+    resume_store *p_store = p_batch->p_store;
+
+    eina_lock_take(&p_store->lock);
+    if (p_batch->i_generation > p_store->i_written)
+    {
+        resume_db_write(p_batch->psz_db_path, p_batch->p_writes, p_batch->i_count);
+        p_store->i_written = p_batch->i_generation;
+    }
+    eina_lock_release(&p_store->lock);
+}
+
+static void
+resume_store_free(resume_store *p_store)
+{
+    eina_lock_free(&p_store->lock);
+    if (p_store->p_positions)
+        eina_hash_free(p_store->p_positions);
+    if (p_store->p_dirty)
+        eina_hash_free(p_store->p_dirty);
+    free(p_store->psz_db_path);
+    free(p_store);
+}
+
+static void
+resume_flush_run_cb(void *data, Ecore_Thread *thread)
+{
+    resume_batch_write(data);
+}
+
+static void
+resume_flush_end_cb(void *data, Ecore_Thread *thread)
+{
+    resume_batch *p_batch = data;
+    resume_store *p_store = p_batch->p_store;
+
+    resume_batch_destroy(p_batch);
+    p_store->p_flush_thread = NULL;
+    p_store->p_flush_batch = NULL;
+
+    if (p_store->b_destroyed)
+    {
+        resume_store_free(p_store);
+        return;
+    }
+    if (p_store->b_flush_again)
+    {
+        p_store->b_flush_again = false;
+        resume_store_flush(p_store);
+    }
+}
+
+void
+resume_store_flush(resume_store *p_store)
+{
+    /* A single batch runs at a time, so writes reach the disk in order */
+    if (p_store->p_flush_thread)
+    {
+        p_store->b_flush_again = true;
+        return;
+    }
+
+    resume_batch *p_batch = resume_batch_create(p_store);
+    if (p_batch == NULL)
+        return;
+
+    LOGD("resume_store: writing %u positions", p_batch->i_count);
+    p_store->p_flush_batch = p_batch;
+    p_store->p_flush_thread = ecore_thread_run(resume_flush_run_cb, resume_flush_end_cb,
+                                               resume_flush_end_cb, p_batch);
+}
+
+static void
+resume_store_mark_dirty(resume_store *p_store, const char *psz_mrl, double f_time)
+{
+    double *p_time = malloc(sizeof(*p_time));
+    if (p_time == NULL)
+        return;
+    *p_time = f_time;
+    free(eina_hash_set(p_store->p_dirty, psz_mrl, p_time));
+}
+
+void
+resume_store_destroy(resume_store *p_store)
+{
+    /* The running batch may not have been written yet. Include its positions
+     * in the last write, unless they changed since, so it can be skipped */
+    resume_batch *p_running = p_store->p_flush_batch;
+    for (unsigned int i = 0; p_running != NULL && i < p_running->i_count; ++i)
+    {
+        if (eina_hash_find(p_store->p_dirty, p_running->p_writes[i].psz_mrl) == NULL)
+            resume_store_mark_dirty(p_store, p_running->p_writes[i].psz_mrl, p_running->p_writes[i].f_time);
+    }
+
+    /* The application is exiting: the last positions are written right away */
+    resume_batch *p_batch = resume_batch_create(p_store);
+    if (p_batch != NULL)
+    {
+        resume_batch_write(p_batch);
+        resume_batch_destroy(p_batch);
+    }
+
+    if (p_store->p_flush_thread)
+        p_store->b_destroyed = true;
+    else
+        resume_store_free(p_store);
+}
+
+double
+resume_store_get(resume_store *p_store, const char *psz_mrl)
+{
+    double *p_time = eina_hash_find(p_store->p_positions, psz_mrl);
+    return p_time ? *p_time : 0.0;
+}
+
+void
+resume_store_set(resume_store *p_store, const char *psz_mrl, double f_time)
+{
+    if (psz_mrl == NULL)
+        return;
+    if (f_time < RESUME_MARGIN)
+    {
+        resume_store_clear(p_store, psz_mrl);
+        return;
+    }
+
+    double *p_time = eina_hash_find(p_store->p_positions, psz_mrl);
+    if (p_time != NULL)
+    {
+        if (*p_time == f_time)
+            return;
+        *p_time = f_time;
+    }
+    else
+    {
+        p_time = malloc(sizeof(*p_time));
+        if (p_time == NULL)
+            return;
+        *p_time = f_time;
+        eina_hash_add(p_store->p_positions, psz_mrl, p_time);
+    }
+    resume_store_mark_dirty(p_store, psz_mrl, f_time);
+}
+
+void
+resume_store_clear(resume_store *p_store, const char *psz_mrl)
+{
+    if (psz_mrl == NULL || eina_hash_find(p_store->p_positions, psz_mrl) == NULL)
+        return;
+
+    eina_hash_del_by_key(p_store->p_positions, psz_mrl);
+    resume_store_mark_dirty(p_store, psz_mrl, -1.0);
+}
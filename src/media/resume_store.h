@@ -0,0 +1,57 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+#ifndef RESUME_STORE_H
+#define RESUME_STORE_H
+
+typedef struct resume_store resume_store;
+
+/*
+ * Remembers where each media was left, keyed by its path or MRL.
+ * Positions are kept in memory and only written to disk by
+ * resume_store_flush(), in a single transaction run off the main loop.
+ */
+resume_store *
+resume_store_create(const char *psz_db_path);
+
+/* Writes the pending positions synchronously, then frees the store */
+void
+resume_store_destroy(resume_store *p_store);
+
+/* Returns the saved position in seconds, or 0 if there is none */
+double
+resume_store_get(resume_store *p_store, const char *psz_mrl);
+
+void
+resume_store_set(resume_store *p_store, const char *psz_mrl, double f_time);
+
+/* Forgets the position, e.g. once the media was played until its end */
+void
+resume_store_clear(resume_store *p_store, const char *psz_mrl);
+
+/* Writes the positions changed since the last flush in a background thread */
+void
+resume_store_flush(resume_store *p_store);
+
+#endif /* RESUME_STORE_H */
@@ -25,6 +25,7 @@
 #include "common.h"
 
 #include <assert.h>
+#include <math.h>
 
 #include <Elementary.h>
 #include <Emotion.h>
@@ -36,7 +37,11 @@
 #include <media_key.h>
 
 #include "playback_service.h"
+#include "system_storage.h"
 #include "media/media_list.h"
+#include "media/queue_store.h"
+#include "media/resume_store.h"
+#include "preferences/decoder_calibration.h"
 #include "preferences/preferences.h"
 #include "ui/equalizer.h"
 
@@ -44,6 +49,26 @@
 
 #define PLAYLIST_CONTEXT_COUNT (PLAYLIST_CONTEXT_OTHERS)
 
+/* Decoded frame rates are measured over that much steady video playback */
+#define PS_CALIBRATION_WINDOW 10.0
+/* A longer gap between two frames means a pause, a seek or buffering */
+#define PS_CALIBRATION_MAX_GAP 1.0
+/* Frame intervals are counted per quarter of millisecond, up to 250 ms */
+#define PS_CALIBRATION_INTERVAL_STEP 0.25
+#define PS_CALIBRATION_INTERVALS 1000
+
+/* Remaining time, in seconds, under which the next audio media gets opened */
+#define PS_GAPLESS_PREROLL 5.0
+
+#define PS_CROSSFADE_MAX 12.0
+/* Gains are updated at 20Hz, which is smooth enough for the ear */
+#define PS_CROSSFADE_STEP 0.05
+
+/* Audio medias shorter than that, in seconds, always start from the beginning */
+#define RESUME_MIN_AUDIO_LENGTH (20 * 60)
+/* A media stopped that close to its end is considered finished */
+#define RESUME_END_MARGIN 15.0
+
 static const int META_EMOTIOM_TO_MEDIA_ITEM[] = {
     MEDIA_ITEM_META_TITLE,
     MEDIA_ITEM_META_ARTIST,
@@ -61,6 +86,30 @@ static const char *STR_POWER_LOCKS[] = {
     "POWER_LOCK_DISPLAY_DIM",
 };
 
+/* A registered set of callbacks, returned as playback_service_cbs_id */
+typedef struct ps_subscriber
+{
+    playback_service_callbacks cbs;
+    double f_last_time_update;  /* ecore_loop_time_get() of the last pf_on_new_time */
+    bool b_time_updates;
+    bool b_removed;             /* unregistered during a dispatch */
+} ps_subscriber;
+
+enum ps_event
+{
+    PS_EVENT_MEDIA_ADDED,
+    PS_EVENT_MEDIA_RANGE_ADDED,
+    PS_EVENT_MEDIA_REMOVED,
+    PS_EVENT_MEDIA_SELECTED,
+    PS_EVENT_STARTED,
+    PS_EVENT_PLAYPAUSE,
+    PS_EVENT_STOPPED,
+    PS_EVENT_NEW_LEN,
+    PS_EVENT_NEW_TIME,
+    PS_EVENT_SEEK_DONE,
+    PS_EVENT_COUNT,
+};
+
 struct playback_service
 {
     enum PLAYLIST_CONTEXT i_ctx;
@@ -72,7 +121,35 @@ struct playback_service
     Evas *p_ea_evas;
     Evas *p_ev_evas;
 
-    Eina_List *p_cbs_list;
+    /* Gapless audio: the next media is opened ahead in a standby emotion
+     * object, which gets swapped with p_ea once the current one ends */
+    Evas_Object *p_ea_next;
+    media_item *p_next_mi;
+    bool b_gapless_switch;
+    double f_transition_start;  /* ecore_time_get() at the end of the previous media, or 0 */
+    double f_last_gap_ms;
+
+    /* Crossfade: the previous media keeps playing in p_fade_out while the
+     * next one starts in p_ea */
+    double f_crossfade;         /* in seconds, 0 when disabled */
+    Evas_Object *p_fade_out;
+    Ecore_Timer *p_fade_timer;
+    double f_fade_start;
+    double f_fade_volume;
+
+    /* All the subscribers in registration order, and for each context and
+     * event the subscribers implementing it */
+    Eina_Array *p_subscribers;
+    Eina_Array *p_event_subs[PLAYLIST_CONTEXT_COUNT][PS_EVENT_COUNT];
+    unsigned int i_dispatching;     /* nested dispatch depth */
+    bool b_subs_removed;            /* subscribers left to compact after dispatch */
+
+    /* Position updates are coalesced into one dispatch per main loop
+     * iteration, and only sent to the subscribers that want them */
+    Ecore_Job *p_time_job;
+    double f_time;
+    double f_pos;
+    bool b_ui_visible;
 
     int i_current_lock;
 
@@ -81,6 +158,37 @@ struct playback_service
 
     bool b_auto_exit;
     bool b_restart_emotion;
+
+    /* libvlc options the current emotion objects were created with. Media
+     * options changes only need the idle objects to be recreated, global
+     * ones need a full emotion restart */
+    char *psz_global_options;
+    char *psz_media_options;
+    bool b_refresh_audio;
+    bool b_refresh_video;
+
+    /* The video object is created with the decoding options suited to the
+     * size of the last video, as calibrated by decoder_calibration */
+    int i_video_w, i_video_h;
+    char *psz_video_options;
+    int i_video_level;              /* calibration level, -1 if not automatic */
+    unsigned int i_calib_frames;
+    double f_calib_start, f_calib_last;
+    /* Frame intervals of the measure: the median one gives the nominal
+     * rate of the video, longer ones follow dropped frames */
+    unsigned int i_calib_intervals[PS_CALIBRATION_INTERVALS];
+    double f_calib_nominal_fps;     /* highest nominal rate of the media */
+
+    /* Where each media was left. Videos, and audio medias longer than
+     * RESUME_MIN_AUDIO_LENGTH, are resumed from there */
+    resume_store *p_resume;
+    const char *psz_resume_mrl;     /* stringshare, media loaded in p_e */
+
+    /* The queues are saved and restored across kills. The current media of a
+     * restored queue starts where it was left */
+    queue_store *p_queue_store;
+    media_item *p_restored_mi[PLAYLIST_CONTEXT_COUNT];
+    double f_restored_time[PLAYLIST_CONTEXT_COUNT];
     bool b_video_background;
 
     minicontrol     *p_minicontrol;
@@ -92,28 +200,120 @@ struct playback_service
     Ecore_Timer *media_key_timer;
 };
 
-#define PS_SEND_CALLBACK(pf_cb, ...) do { \
-    if (p_ps->p_cbs_list) { \
-        Eina_List *p_el, *p_el_next; \
-        playback_service_callbacks *p_cbs; \
-        EINA_LIST_FOREACH_SAFE(p_ps->p_cbs_list, p_el_next, p_el, p_cbs) { \
-            if (p_cbs->pf_cb && (p_cbs->i_ctx == p_ps->i_ctx || p_cbs->i_ctx == PLAYLIST_CONTEXT_NONE)) \
-                p_cbs->pf_cb(p_ps, p_cbs->p_user_data, __VA_ARGS__); \
-        } \
+static bool
+ps_subscriber_has_event(const ps_subscriber *p_sub, enum ps_event i_event)
+{
+    const playback_service_callbacks *p_cbs = &p_sub->cbs;
+
+    switch (i_event)
+    {
+    case PS_EVENT_MEDIA_ADDED:
+        return p_cbs->pf_on_media_added != NULL;
+    case PS_EVENT_MEDIA_RANGE_ADDED:
+        return p_cbs->pf_on_media_range_added != NULL || p_cbs->pf_on_media_added != NULL;
+    case PS_EVENT_MEDIA_REMOVED:
+        return p_cbs->pf_on_media_removed != NULL;
+    case PS_EVENT_MEDIA_SELECTED:
+        return p_cbs->pf_on_media_selected != NULL;
+    case PS_EVENT_STARTED:
+        return p_cbs->pf_on_started != NULL;
+    case PS_EVENT_PLAYPAUSE:
+        return p_cbs->pf_on_playpause != NULL;
+    case PS_EVENT_STOPPED:
+        return p_cbs->pf_on_stopped != NULL;
+    case PS_EVENT_NEW_LEN:
+        return p_cbs->pf_on_new_len != NULL;
+    case PS_EVENT_NEW_TIME:
+        return p_cbs->pf_on_new_time != NULL;
+    case PS_EVENT_SEEK_DONE:
+        return p_cbs->pf_on_seek_done != NULL;
+    default:
+        return false;
+    }
+}
+
+static inline Eina_Array *
+ps_event_subscribers(playback_service *p_ps, enum ps_event i_event)
+{
+    return p_ps->p_event_subs[p_ps->i_ctx - 1][i_event];
+}
+
+static Eina_Bool
+ps_subscriber_keep_cb(void *data, void *gdata)
+{
+    ps_subscriber *p_sub = data;
+    return !p_sub->b_removed;
+}
+
+static Eina_Bool
+ps_subscriber_keep_or_free_cb(void *data, void *gdata)
+{
+    ps_subscriber *p_sub = data;
+    if (!p_sub->b_removed)
+        return EINA_TRUE;
+    free(p_sub);
+    return EINA_FALSE;
+}
+
+/* Drop the unregistered subscribers, never while a dispatch is running */
+static void
+ps_subscribers_compact(playback_service *p_ps)
+{
+    if (p_ps->i_dispatching > 0 || !p_ps->b_subs_removed)
+        return;
+
+    for (unsigned int i = 0; i < PLAYLIST_CONTEXT_COUNT; ++i)
+        for (unsigned int j = 0; j < PS_EVENT_COUNT; ++j)
+            eina_array_remove(p_ps->p_event_subs[i][j], ps_subscriber_keep_cb, NULL);
+    eina_array_remove(p_ps->p_subscribers, ps_subscriber_keep_or_free_cb, NULL);
+
+    p_ps->b_subs_removed = false;
+}
+
+static inline void
+ps_dispatch_begin(playback_service *p_ps)
+{
+    p_ps->i_dispatching++;
+}
+
+static inline void
+ps_dispatch_end(playback_service *p_ps)
+{
+    p_ps->i_dispatching--;
+    ps_subscribers_compact(p_ps);
+}
+
+/* Subscribers registered during a dispatch are only called from the next one */
+#define PS_SEND_CALLBACK(i_event, pf_cb, ...) do { \
+    Eina_Array *p_subs = ps_event_subscribers(p_ps, i_event); \
+    unsigned int i_count = eina_array_count(p_subs); \
+    ps_dispatch_begin(p_ps); \
+    for (unsigned int i_sub = 0; i_sub < i_count; ++i_sub) { \
+        ps_subscriber *p_sub = eina_array_data_get(p_subs, i_sub); \
+        if (!p_sub->b_removed) \
+            p_sub->cbs.pf_cb(p_ps, p_sub->cbs.p_user_data, __VA_ARGS__); \
     } \
+    ps_dispatch_end(p_ps); \
 } while(0)
 
-#define PS_SEND_VOID_CALLBACK(pf_cb) do { \
-    if (p_ps->p_cbs_list) { \
-        Eina_List *p_el, *p_el_next; \
-        playback_service_callbacks *p_cbs; \
-        EINA_LIST_FOREACH_SAFE(p_ps->p_cbs_list, p_el_next, p_el, p_cbs) { \
-            if (p_cbs->pf_cb && (p_cbs->i_ctx == p_ps->i_ctx || p_cbs->i_ctx == PLAYLIST_CONTEXT_NONE)) \
-                p_cbs->pf_cb(p_ps, p_cbs->p_user_data); \
-        } \
+#define PS_SEND_VOID_CALLBACK(i_event, pf_cb) do { \
+    Eina_Array *p_subs = ps_event_subscribers(p_ps, i_event); \
+    unsigned int i_count = eina_array_count(p_subs); \
+    ps_dispatch_begin(p_ps); \
+    for (unsigned int i_sub = 0; i_sub < i_count; ++i_sub) { \
+        ps_subscriber *p_sub = eina_array_data_get(p_subs, i_sub); \
+        if (!p_sub->b_removed) \
+            p_sub->cbs.pf_cb(p_ps, p_sub->cbs.p_user_data); \
     } \
+    ps_dispatch_end(p_ps); \
 } while(0)
 
+static void
+ps_gapless_arm(playback_service *p_ps, double i_time, double i_len);
+
+static bool
+ps_gapless_switch(playback_service *p_ps, bool b_crossfade);
+
 void
 ps_register_on_emotion_restart_cb(playback_service *p_ps, ps_on_emotion_restart func, void *data)
 {
@@ -149,20 +349,93 @@ static void
 ps_emotion_length_change_cb(void *data, Evas_Object *obj, void *event)
 {
     playback_service *p_ps = data;
+    if (obj != p_ps->p_e)
+        return;
     double i_len = emotion_object_play_length_get(obj);
 
-    PS_SEND_CALLBACK(pf_on_new_len, i_len);
+    PS_SEND_CALLBACK(PS_EVENT_NEW_LEN, pf_on_new_len, i_len);
+}
+
+static bool
+ps_subscriber_wants_time(ps_subscriber *p_sub, double f_now)
+{
+    return !p_sub->b_removed && p_sub->b_time_updates
+        && f_now - p_sub->f_last_time_update >= p_sub->cbs.f_time_interval;
+}
+
+static void
+ps_time_dispatch_job(void *data)
+{
+    playback_service *p_ps = data;
+    Eina_Array *p_subs = ps_event_subscribers(p_ps, PS_EVENT_NEW_TIME);
+    unsigned int i_count = eina_array_count(p_subs);
+    double f_now = ecore_loop_time_get();
+
+    p_ps->p_time_job = NULL;
+
+    ps_dispatch_begin(p_ps);
+    for (unsigned int i = 0; i < i_count; ++i)
+    {
+        ps_subscriber *p_sub = eina_array_data_get(p_subs, i);
+        if (!ps_subscriber_wants_time(p_sub, f_now))
+            continue;
+        p_sub->f_last_time_update = f_now;
+        p_sub->cbs.pf_on_new_time(p_ps, p_sub->cbs.p_user_data, p_ps->f_time, p_ps->f_pos);
+    }
+    ps_dispatch_end(p_ps);
+}
+
+/* Schedule a position dispatch, unless nobody visible is due for one */
+static void
+ps_time_schedule(playback_service *p_ps)
+{
+    Eina_Array *p_subs;
+    double f_now = ecore_loop_time_get();
+
+    if (p_ps->p_time_job || !p_ps->b_ui_visible)
+        return;
+
+    p_subs = ps_event_subscribers(p_ps, PS_EVENT_NEW_TIME);
+    for (unsigned int i = 0; i < eina_array_count(p_subs); ++i)
+    {
+        if (ps_subscriber_wants_time(eina_array_data_get(p_subs, i), f_now))
+        {
+            p_ps->p_time_job = ecore_job_add(ps_time_dispatch_job, p_ps);
+            return;
+        }
+    }
+}
+
+/* Make the next position update reach every subscriber, whatever its interval */
+static void
+ps_time_flush(playback_service *p_ps)
+{
+    for (unsigned int i = 0; i < eina_array_count(p_ps->p_subscribers); ++i)
+    {
+        ps_subscriber *p_sub = eina_array_data_get(p_ps->p_subscribers, i);
+        p_sub->f_last_time_update = 0.0;
+    }
+
+    if (p_ps->b_started)
+    {
+        p_ps->f_time = playback_service_get_time(p_ps);
+        p_ps->f_pos = playback_service_get_pos(p_ps);
+        ps_time_schedule(p_ps);
+    }
 }
 
 static void
 ps_emotion_position_update_cb(void *data, Evas_Object *obj, void *event)
 {
     playback_service *p_ps = data;
+    if (obj != p_ps->p_e)
+        return;
 
     if (p_ps->b_seeking)
     {
         p_ps->b_seeking = false;
-        PS_SEND_VOID_CALLBACK(pf_on_seek_done);
+        PS_SEND_VOID_CALLBACK(PS_EVENT_SEEK_DONE, pf_on_seek_done);
+        ps_time_flush(p_ps);
     }
     else
     {
@@ -178,7 +451,14 @@ ps_emotion_position_update_cb(void *data, Evas_Object *obj, void *event)
             mini_control_progress_set(p_ps->p_minicontrol, i_pos);
         }
 
-        PS_SEND_CALLBACK(pf_on_new_time, i_time, i_pos);
+        p_ps->f_time = i_time;
+        p_ps->f_pos = i_pos;
+        ps_time_schedule(p_ps);
+
+        ps_gapless_arm(p_ps, i_time, i_len);
+        if (p_ps->f_crossfade > 0.0 && p_ps->p_next_mi != NULL &&
+            i_len > p_ps->f_crossfade && i_len - i_time <= p_ps->f_crossfade)
+            ps_gapless_switch(p_ps, true);
     }
 }
 
@@ -186,17 +466,38 @@ static void
 ps_emotion_play_started_cb(void *data, Evas_Object *obj, void *event)
 {
     playback_service *p_ps = data;
+    if (obj != p_ps->p_e)
+        return;
     media_item *p_mi = media_list_get_item(p_ps->p_ml);
+    media_item *p_new_mi = NULL;
     const char *meta;
 
+    if (p_ps->f_transition_start > 0)
+    {
+        p_ps->f_last_gap_ms = (ecore_time_get() - p_ps->f_transition_start) * 1000.0;
+        p_ps->f_transition_start = 0;
+        LOGD("Transition gap: %.1f ms", p_ps->f_last_gap_ms);
+    }
+
+    /* The item is shared with the views: update a copy of it */
     for (unsigned int i = 0; i < EMOTION_META_INFO_TRACK_COUNT; ++i)
     {
         meta = emotion_object_meta_info_get(obj, i);
-        if (meta != NULL)
-            media_item_set_meta(p_mi, META_EMOTIOM_TO_MEDIA_ITEM[i], meta);
+        if (meta == NULL ||
+            library_item_str_equals(p_mi->psz_metas[META_EMOTIOM_TO_MEDIA_ITEM[i]], meta))
+            continue;
+        if (p_new_mi == NULL && (p_new_mi = media_item_copy(p_mi)) == NULL)
+            break;
+        media_item_set_meta(p_new_mi, META_EMOTIOM_TO_MEDIA_ITEM[i], meta);
+    }
+    if (p_new_mi != NULL)
+    {
+        media_list_replace_item(p_ps->p_ml, media_list_get_pos(p_ps->p_ml), p_new_mi);
+        p_mi = p_new_mi;
     }
 
-    PS_SEND_CALLBACK(pf_on_started, p_mi);
+    PS_SEND_CALLBACK(PS_EVENT_STARTED, pf_on_started, p_mi);
+    ps_time_flush(p_ps);
 
     mini_control_playing_set(p_ps->p_minicontrol, EINA_TRUE);
 
@@ -215,16 +516,61 @@ ps_emotion_play_started_cb(void *data, Evas_Object *obj, void *event)
     }
 }
 
+static bool
+ps_resume_allowed(playback_service *p_ps, double f_len)
+{
+    return p_ps->p_e == p_ps->p_ev || f_len >= RESUME_MIN_AUDIO_LENGTH;
+}
+
+/* Remember where the loaded media is, only in memory */
+static void
+ps_resume_save(playback_service *p_ps)
+{
+    if (!p_ps->b_started || p_ps->psz_resume_mrl == NULL || p_ps->p_resume == NULL)
+        return;
+
+    double f_time = emotion_object_position_get(p_ps->p_e);
+    double f_len = emotion_object_play_length_get(p_ps->p_e);
+    if (!ps_resume_allowed(p_ps, f_len))
+        return;
+
+    if (f_len - f_time < RESUME_END_MARGIN)
+        resume_store_clear(p_ps->p_resume, p_ps->psz_resume_mrl);
+    else
+        resume_store_set(p_ps->p_resume, p_ps->psz_resume_mrl, f_time);
+}
+
+/* The loaded media was played until its end: start it over next time */
+static void
+ps_resume_finished(playback_service *p_ps)
+{
+    if (p_ps->psz_resume_mrl == NULL || p_ps->p_resume == NULL)
+        return;
+
+    resume_store_clear(p_ps->p_resume, p_ps->psz_resume_mrl);
+    eina_stringshare_replace(&p_ps->psz_resume_mrl, NULL);
+}
+
 static void
 ps_emotion_play_finished_cb(void *data, Evas_Object *obj, void *event)
 {
     playback_service *p_ps = data;
+    if (obj != p_ps->p_e)
+        return;
 
     LOGD("ps_emotion_play_finished_cb");
 
+    ps_resume_finished(p_ps);
+    p_ps->f_transition_start = ecore_time_get();
+    if (ps_gapless_switch(p_ps, false))
+        return;
+
     /* play next file or stop */
     if (!media_list_set_next(p_ps->p_ml))
+    {
+        p_ps->f_transition_start = 0;
         playback_service_stop_notify(p_ps, true);
+    }
 }
 
 static void
@@ -233,7 +579,33 @@ ml_on_media_added_cb(media_list *p_ml, void *p_user_data, unsigned int i_pos,
 {
     playback_service *p_ps = p_user_data;
 
-    PS_SEND_CALLBACK(pf_on_media_added, i_pos, p_mi);
+    PS_SEND_CALLBACK(PS_EVENT_MEDIA_ADDED, pf_on_media_added, i_pos, p_mi);
+}
+
+static void
+ml_on_range_added_cb(media_list *p_ml, void *p_user_data, unsigned int i_pos,
+                     unsigned int i_count)
+{
+    playback_service *p_ps = p_user_data;
+    Eina_Array *p_subs = ps_event_subscribers(p_ps, PS_EVENT_MEDIA_RANGE_ADDED);
+    unsigned int i_subs = eina_array_count(p_subs);
+
+    ps_dispatch_begin(p_ps);
+    for (unsigned int i_sub = 0; i_sub < i_subs; ++i_sub)
+    {
+        ps_subscriber *p_sub = eina_array_data_get(p_subs, i_sub);
+        if (p_sub->b_removed)
+            continue;
+        if (p_sub->cbs.pf_on_media_range_added)
+            p_sub->cbs.pf_on_media_range_added(p_ps, p_sub->cbs.p_user_data, i_pos, i_count);
+        else
+        {
+            for (unsigned int i = 0; i < i_count && !p_sub->b_removed; ++i)
+                p_sub->cbs.pf_on_media_added(p_ps, p_sub->cbs.p_user_data, i_pos + i,
+                                             media_list_get_item_at(p_ml, i_pos + i));
+        }
+    }
+    ps_dispatch_end(p_ps);
 }
 
 static void
@@ -242,7 +614,23 @@ ml_on_media_removed_cb(media_list *p_ml, void *p_user_data, unsigned int i_pos,
 {
     playback_service *p_ps = p_user_data;
 
-    PS_SEND_CALLBACK(pf_on_media_removed, i_pos, p_mi);
+    PS_SEND_CALLBACK(PS_EVENT_MEDIA_REMOVED, pf_on_media_removed, i_pos, p_mi);
+}
+
+static void
+ml_on_media_cleared_cb(media_list *p_ml, void *p_user_data, unsigned int i_count)
+{
+    playback_service *p_ps = p_user_data;
+
+    /* Don't walk the whole list when nobody listens to removals */
+    if (eina_array_count(ps_event_subscribers(p_ps, PS_EVENT_MEDIA_REMOVED)) == 0)
+        return;
+
+    for (unsigned int i = 0; i < i_count; ++i)
+    {
+        media_item *p_mi = media_list_get_item_at(p_ml, i);
+        PS_SEND_CALLBACK(PS_EVENT_MEDIA_REMOVED, pf_on_media_removed, i, p_mi);
+    }
 }
 
 static void
@@ -253,14 +641,152 @@ ml_on_media_selected_cb(media_list *p_ml, void *p_user_data, int i_pos,
     if (p_ml != p_ps->p_ml)
         return;
 
-    if (p_ps->b_started)
+    /* When switching gaplessly, the media is already playing */
+    if (p_ps->b_started && !p_ps->b_gapless_switch)
     {
         LOGD("ml_on_media_selected_cb: %d", i_pos);
 
         if (i_pos < 0 || playback_service_start(p_ps, 0) != 0)
             playback_service_stop_notify(p_ps, true);
     }
-    PS_SEND_CALLBACK(pf_on_media_selected, i_pos, p_mi);
+    PS_SEND_CALLBACK(PS_EVENT_MEDIA_SELECTED, pf_on_media_selected, i_pos, p_mi);
+}
+
+static void
+ps_emotion_equalizer_apply(Evas_Object *p_e)
+{
+    if ( equalizer_is_enabled() )
+    {
+        float f_preamp = equalizer_get_preamp_value();
+        unsigned int i_nb_bands = equalizer_get_nb_bands();
+        float f_bands[i_nb_bands];
+        for ( unsigned int i = 0; i < i_nb_bands; ++i )
+            f_bands[i] = equalizer_get_band_value( i );
+        emotion_object_equalizer_set( p_e, f_preamp, i_nb_bands, f_bands );
+    }
+}
+
+static void
+ps_options_snapshot(playback_service *p_ps)
+{
+    free(p_ps->psz_global_options);
+    free(p_ps->psz_media_options);
+    p_ps->psz_global_options = preferences_get_libvlc_global_options();
+    p_ps->psz_media_options = preferences_get_libvlc_media_options();
+}
+
+static bool
+ps_options_changed(const char *psz_old, const char *psz_new)
+{
+    if (psz_old == NULL || psz_new == NULL)
+        return psz_old != psz_new;
+    return strcmp(psz_old, psz_new) != 0;
+}
+
+/*
+ * Size of the video being played. The video object is recreated with the
+ * options suited to it once the video stops, if they changed.
+ */
+static void
+ps_video_size_set(playback_service *p_ps, int i_w, int i_h)
+{
+    if (i_w <= 0 || i_h <= 0 || (i_w == p_ps->i_video_w && i_h == p_ps->i_video_h))
+        return;
+
+    p_ps->i_video_w = i_w;
+    p_ps->i_video_h = i_h;
+    if (p_ps->p_ev == NULL)
+        return;
+
+    char *psz_options = preferences_get_libvlc_media_options_for_size(i_w, i_h);
+    if (ps_options_changed(p_ps->psz_video_options, psz_options))
+    {
+        LOGD("decoding options changed for a %dx%d video", i_w, i_h);
+        p_ps->b_refresh_video = true;
+    }
+    free(psz_options);
+}
+
+/* Nominal frame rate, from the median frame interval of the measure */
+static double
+ps_calibration_nominal_fps(playback_service *p_ps)
+{
+    unsigned int i_half = (p_ps->i_calib_frames + 1) / 2;
+    unsigned int i_count = 0;
+
+    for (unsigned int i = 0; i < PS_CALIBRATION_INTERVALS; ++i)
+    {
+        i_count += p_ps->i_calib_intervals[i];
+        if (i_count >= i_half)
+            return 1000.0 / ((i + 0.5) * PS_CALIBRATION_INTERVAL_STEP);
+    }
+    return 0.0;
+}
+
+static void
+ps_calibration_reset(playback_service *p_ps, double f_now)
+{
+    p_ps->i_calib_frames = 0;
+    p_ps->f_calib_start = p_ps->f_calib_last = f_now;
+    memset(p_ps->i_calib_intervals, 0, sizeof(p_ps->i_calib_intervals));
+}
+
+static void
+ps_emotion_frame_decode_cb(void *data, Evas_Object *obj, void *event)
+{
+    playback_service *p_ps = data;
+    double f_now = ecore_time_get();
+
+    if (obj != p_ps->p_ev || p_ps->i_video_level < 0)
+        return;
+
+    if (p_ps->b_seeking || f_now - p_ps->f_calib_last > PS_CALIBRATION_MAX_GAP ||
+        emotion_object_play_speed_get(obj) != 1.0)
+    {
+        /* Start a new measure */
+        ps_calibration_reset(p_ps, f_now);
+        return;
+    }
+
+    unsigned int i_interval = (f_now - p_ps->f_calib_last) * 1000.0 / PS_CALIBRATION_INTERVAL_STEP;
+    if (i_interval >= PS_CALIBRATION_INTERVALS)
+        i_interval = PS_CALIBRATION_INTERVALS - 1;
+    p_ps->i_calib_intervals[i_interval]++;
+
+    p_ps->f_calib_last = f_now;
+    p_ps->i_calib_frames++;
+    if (f_now - p_ps->f_calib_start >= PS_CALIBRATION_WINDOW)
+    {
+        /* When most frames are dropped, the median is a multiple of the
+         * nominal interval: the best measure of the media is kept */
+        double f_nominal_fps = ps_calibration_nominal_fps(p_ps);
+        if (f_nominal_fps > p_ps->f_calib_nominal_fps)
+            p_ps->f_calib_nominal_fps = f_nominal_fps;
+
+        int i_w, i_h;
+        emotion_object_size_get(obj, &i_w, &i_h);
+        ps_video_size_set(p_ps, i_w, i_h);
+        decoder_calibration_report(i_w, i_h, p_ps->i_video_level,
+                                   p_ps->i_calib_frames / (f_now - p_ps->f_calib_start),
+                                   p_ps->f_calib_nominal_fps);
+        ps_calibration_reset(p_ps, f_now);
+    }
+}
+
+/* libvlc options of the video object, for the size of the next video */
+static char *
+ps_video_options_get(playback_service *p_ps)
+{
+    char *psz_media = preferences_get_libvlc_media_options_for_size(p_ps->i_video_w, p_ps->i_video_h);
+    char *psz_global = preferences_get_libvlc_global_options();
+    char *buf = NULL;
+
+    if (psz_media && psz_global && asprintf(&buf, "%s %s", psz_media, psz_global) < 0)
+        buf = NULL;
+
+    free(psz_media);
+    free(psz_global);
+    return buf;
 }
 
 static Evas_Object *
@@ -268,8 +794,18 @@ ps_emotion_create(playback_service *p_ps, Evas *p_evas, bool b_mute_video)
 {
     char *options;
 
+    if (!b_mute_video)
+    {
+        free(p_ps->psz_video_options);
+        p_ps->psz_video_options = preferences_get_libvlc_media_options_for_size(p_ps->i_video_w,
+                                                                                p_ps->i_video_h);
+        p_ps->i_video_level = preferences_get_enum(PREF_DEBLOCKING, DEBLOCKING_AUTOMATIC) == DEBLOCKING_AUTOMATIC
+                            ? decoder_calibration_get_level(p_ps->i_video_w, p_ps->i_video_h) : -1;
+    }
+
     /* Prepare libvlc options */
-    if ((options = preferences_get_libvlc_options()) != NULL)
+    options = b_mute_video ? preferences_get_libvlc_options() : ps_video_options_get(p_ps);
+    if (options != NULL)
     {
         unsetenv("EMOTION_LIBVLC_ARGS");
         if (setenv("EMOTION_LIBVLC_ARGS", options, 0) != 0)
@@ -306,21 +842,16 @@ ps_emotion_create(playback_service *p_ps, Evas *p_evas, bool b_mute_video)
                                    ps_emotion_play_started_cb, p_ps);
     evas_object_smart_callback_add(p_e, "playback_finished",
                                    ps_emotion_play_finished_cb, p_ps);
+    if (!b_mute_video)
+        evas_object_smart_callback_add(p_e, "frame_decode",
+                                       ps_emotion_frame_decode_cb, p_ps);
     //evas_object_smart_callback_add(p_e, "decode_stop",ps_emotion_stop_cb, p_ps);
     //evas_object_smart_callback_add(p_e, "progress_change", ps_emotion_progress_change_cb, p_ps);
     //evas_object_smart_callback_add(p_e, "audio_level_change", ps_emotion_audio_change, p_ps);
     //evas_object_smart_callback_add(p_e, "channels_change", ps_emotion_channels_change, p_ps);
 
-    if ( equalizer_is_enabled() )
-    {
-        float f_preamp = equalizer_get_preamp_value();
-        unsigned int i_nb_bands = equalizer_get_nb_bands();
-        float f_bands[i_nb_bands];
-        for ( unsigned int i = 0; i < i_nb_bands; ++i )
-            f_bands[i] = equalizer_get_band_value( i );
-        // Don't use playback_service_eq_set since we haven't assigned p_e yet
-        emotion_object_equalizer_set( p_e, f_preamp, i_nb_bands, f_bands );
-    }
+    // Don't use playback_service_eq_set since we haven't assigned p_e yet
+    ps_emotion_equalizer_apply(p_e);
 
     return p_e;
 }
@@ -336,9 +867,149 @@ ps_emotion_destroy(playback_service *p_ps, Evas_Object *p_e)
                                    ps_emotion_play_started_cb);
     evas_object_smart_callback_del(p_e, "playback_finished",
                                    ps_emotion_play_finished_cb);
+    evas_object_smart_callback_del(p_e, "frame_decode",
+                                   ps_emotion_frame_decode_cb);
     evas_object_del(p_e);
 }
 
+static void
+ps_gapless_disarm(playback_service *p_ps)
+{
+    if (p_ps->p_next_mi == NULL)
+        return;
+    emotion_object_file_set(p_ps->p_ea_next, NULL);
+    media_item_unref(p_ps->p_next_mi);
+    p_ps->p_next_mi = NULL;
+}
+
+/*
+ * Opens the next audio media in the standby emotion object when the current
+ * one is about to end, so that switching to it doesn't have to wait for
+ * the demuxer and decoders to start.
+ */
+static void
+ps_gapless_arm(playback_service *p_ps, double i_time, double i_len)
+{
+    /* Open the next media a bit ahead of the crossfade start */
+    double f_preroll = PS_GAPLESS_PREROLL + p_ps->f_crossfade;
+    if (p_ps->i_ctx != PLAYLIST_CONTEXT_AUDIO || p_ps->p_e != p_ps->p_ea ||
+        p_ps->p_next_mi != NULL || p_ps->p_fade_timer != NULL ||
+        i_len <= 0.0 || i_len - i_time > f_preroll)
+        return;
+
+    media_item *p_next_mi = media_list_get_next_item(p_ps->p_ml);
+    if (p_next_mi == NULL || p_next_mi->psz_path == NULL)
+        return;
+    if (p_ps->p_ea_next == NULL)
+    {
+        p_ps->p_ea_next = ps_emotion_create(p_ps, p_ps->p_ea_evas, true);
+        if (p_ps->p_ea_next == NULL)
+            return;
+    }
+    else
+        ps_emotion_equalizer_apply(p_ps->p_ea_next);
+
+    if (!emotion_object_file_set(p_ps->p_ea_next, p_next_mi->psz_path))
+    {
+        LOGE("gapless: emotion_object_file_set failed");
+        return;
+    }
+    emotion_object_play_set(p_ps->p_ea_next, false);
+    emotion_object_play_speed_set(p_ps->p_ea_next, emotion_object_play_speed_get(p_ps->p_e));
+    p_ps->p_next_mi = media_item_ref(p_next_mi);
+    LOGD("gapless: %s ready", p_next_mi->psz_path);
+}
+
+static void
+ps_crossfade_stop(playback_service *p_ps)
+{
+    if (p_ps->p_fade_timer == NULL)
+        return;
+    ecore_timer_del(p_ps->p_fade_timer);
+    p_ps->p_fade_timer = NULL;
+    emotion_object_file_set(p_ps->p_fade_out, NULL);
+    emotion_object_audio_volume_set(p_ps->p_fade_out, p_ps->f_fade_volume);
+    emotion_object_audio_volume_set(p_ps->p_ea, p_ps->f_fade_volume);
+    p_ps->p_fade_out = NULL;
+}
+
+/*
+ * Equal power curves: the sum of both powers stays constant during the
+ * overlap, so there is no loudness dip in the middle of it.
+ */
+static Eina_Bool
+ps_crossfade_step_cb(void *data)
+{
+    playback_service *p_ps = data;
+    double f_elapsed = ecore_time_get() - p_ps->f_fade_start;
+    double t = f_elapsed / p_ps->f_crossfade;
+
+    if (t >= 1.0)
+    {
+        LOGD("Crossfade: %.0f ms overlap, %.0f ms requested", f_elapsed * 1000.0,
+             p_ps->f_crossfade * 1000.0);
+        p_ps->f_last_gap_ms = 0.0;
+        /* The timer is deleted by returning ECORE_CALLBACK_CANCEL */
+        p_ps->p_fade_timer = NULL;
+        emotion_object_file_set(p_ps->p_fade_out, NULL);
+        emotion_object_audio_volume_set(p_ps->p_fade_out, p_ps->f_fade_volume);
+        emotion_object_audio_volume_set(p_ps->p_ea, p_ps->f_fade_volume);
+        p_ps->p_fade_out = NULL;
+        return ECORE_CALLBACK_CANCEL;
+    }
+    emotion_object_audio_volume_set(p_ps->p_fade_out, p_ps->f_fade_volume * cos(t * M_PI_2));
+    emotion_object_audio_volume_set(p_ps->p_ea, p_ps->f_fade_volume * sin(t * M_PI_2));
+    return ECORE_CALLBACK_RENEW;
+}
+
+static void
+ps_crossfade_start(playback_service *p_ps, Evas_Object *p_fade_out)
+{
+    p_ps->p_fade_out = p_fade_out;
+    p_ps->f_fade_volume = emotion_object_audio_volume_get(p_fade_out);
+    p_ps->f_fade_start = ecore_time_get();
+    emotion_object_audio_volume_set(p_ps->p_ea, 0.0);
+    p_ps->p_fade_timer = ecore_timer_add(PS_CROSSFADE_STEP, ps_crossfade_step_cb, p_ps);
+}
+
+/*
+ * Starts the prepared media, if it's still the one to be played next. When
+ * crossfading, the current media keeps playing until the fade is over.
+ * Returns false if a regular transition is needed.
+ */
+static bool
+ps_gapless_switch(playback_service *p_ps, bool b_crossfade)
+{
+    if (p_ps->p_next_mi == NULL)
+        return false;
+    if (p_ps->p_next_mi != media_list_get_next_item(p_ps->p_ml))
+    {
+        /* The list changed in the meantime */
+        ps_gapless_disarm(p_ps);
+        return false;
+    }
+
+    ps_resume_finished(p_ps);
+    eina_stringshare_replace(&p_ps->psz_resume_mrl, p_ps->p_next_mi->psz_path);
+
+    Evas_Object *p_prev = p_ps->p_ea;
+    p_ps->p_ea = p_ps->p_ea_next;
+    p_ps->p_ea_next = p_prev;
+    p_ps->p_e = p_ps->p_ea;
+    if (b_crossfade)
+        ps_crossfade_start(p_ps, p_prev);
+    else
+        emotion_object_file_set(p_prev, NULL);
+    emotion_object_play_set(p_ps->p_e, true);
+    media_item_unref(p_ps->p_next_mi);
+    p_ps->p_next_mi = NULL;
+
+    p_ps->b_gapless_switch = true;
+    media_list_set_next(p_ps->p_ml);
+    p_ps->b_gapless_switch = false;
+    return true;
+}
+
 static media_list *
 get_media_list(playback_service *p_ps, enum PLAYLIST_CONTEXT i_ctx)
 {
@@ -406,6 +1077,36 @@ playback_service_media_key_event(media_key_e key, media_key_event_e status, void
     }
 }
 
+static bool
+ps_queue_restored_cb(void *p_user_data, unsigned int i_queue, Eina_Array *p_items,
+                     const queue_store_state *p_state)
+{
+    playback_service *p_ps = p_user_data;
+    media_list *p_ml = p_ps->p_ml_list[i_queue];
+
+    /* Something was queued in the meantime: keep it */
+    if (media_list_get_count(p_ml) > 0)
+    {
+        for (unsigned int i = 0; i < eina_array_count(p_items); ++i)
+            media_item_unref(eina_array_data_get(p_items, i));
+        return false;
+    }
+
+    LOGD("restoring a queue of %u medias", eina_array_count(p_items));
+    media_list_set_repeat_mode(p_ml, p_state->i_repeat);
+    media_list_replace(p_ml, p_items, p_state->i_pos);
+    if (p_state->b_shuffle)
+        media_list_set_shuffle(p_ml, true, (uint64_t)(ecore_time_unix_get() * 1000000.0));
+
+    media_item *p_mi = media_list_get_item(p_ml);
+    if (p_mi && p_state->f_time > 0)
+    {
+        p_ps->p_restored_mi[i_queue] = media_item_ref(p_mi);
+        p_ps->f_restored_time[i_queue] = p_state->f_time;
+    }
+    return true;
+}
+
 playback_service *
 playback_service_create(application *p_app)
 {
@@ -415,6 +1116,17 @@ playback_service_create(application *p_app)
 
     p_ps->i_current_lock = -1;
     p_ps->b_auto_exit = false;
+    p_ps->f_last_gap_ms = -1.0;
+    p_ps->b_ui_visible = true;
+    playback_service_set_crossfade(p_ps, preferences_get_index(PREF_CROSSFADE, 0));
+
+    p_ps->p_subscribers = eina_array_new(8);
+    if (!p_ps->p_subscribers)
+        goto error;
+    for (unsigned int i = 0; i < PLAYLIST_CONTEXT_COUNT; ++i)
+        for (unsigned int j = 0; j < PS_EVENT_COUNT; ++j)
+            if ((p_ps->p_event_subs[i][j] = eina_array_new(4)) == NULL)
+                goto error;
 
     for (unsigned int i = 0; i < PLAYLIST_CONTEXT_COUNT; ++i)
     {
@@ -422,6 +1134,8 @@ playback_service_create(application *p_app)
                 .pf_on_media_added = ml_on_media_added_cb,
                 .pf_on_media_removed = ml_on_media_removed_cb,
                 .pf_on_media_selected = ml_on_media_selected_cb,
+                .pf_on_cleared = ml_on_media_cleared_cb,
+                .pf_on_range_added = ml_on_range_added_cb,
                 .p_user_data = p_ps,
         };
         p_ps->p_ml_list[i] = media_list_create(true);
@@ -434,6 +1148,8 @@ playback_service_create(application *p_app)
     p_ps->i_ctx = PLAYLIST_CONTEXT_AUDIO;
     p_ps->p_ml = get_media_list(p_ps, p_ps->i_ctx);
 
+    decoder_calibration_init();
+
     p_ps->p_ea_evas = evas_new();
     if (p_ps->p_ea_evas)
     {
@@ -441,6 +1157,27 @@ playback_service_create(application *p_app)
         if (p_ps->p_ea)
             p_ps->p_e = p_ps->p_ea;
     }
+    ps_options_snapshot(p_ps);
+
+    char *psz_appdata = system_storage_appdata_get();
+    if (psz_appdata)
+    {
+        char *psz_db_path;
+        if (asprintf(&psz_db_path, "%s/resume.db", psz_appdata) >= 0)
+        {
+            p_ps->p_resume = resume_store_create(psz_db_path);
+            free(psz_db_path);
+        }
+
+        p_ps->p_queue_store = queue_store_create(psz_appdata, PLAYLIST_CONTEXT_COUNT);
+        if (p_ps->p_queue_store)
+        {
+            for (unsigned int i = 0; i < PLAYLIST_CONTEXT_COUNT; ++i)
+                queue_store_attach(p_ps->p_queue_store, i, p_ps->p_ml_list[i]);
+            queue_store_restore(p_ps->p_queue_store, ps_queue_restored_cb, p_ps);
+        }
+        free(psz_appdata);
+    }
 
     ps_notification_create(p_ps, p_app);
     media_key_reserve(playback_service_media_key_event, p_ps);
@@ -455,25 +1192,44 @@ error:
 void
 playback_service_destroy(playback_service *p_ps)
 {
-    Eina_List *p_el;
-    void *p_id;
-
     media_key_release();
 
+    /* Saves the queues, so it goes before them */
+    if (p_ps->p_queue_store)
+    {
+        if (p_ps->b_started)
+            queue_store_set_time(p_ps->p_queue_store, p_ps->i_ctx - 1,
+                                 emotion_object_position_get(p_ps->p_e));
+        queue_store_destroy(p_ps->p_queue_store);
+    }
+
     for (unsigned int i = 0; i < PLAYLIST_CONTEXT_COUNT; ++i)
     {
         if (p_ps->p_ml_list[i])
             media_list_destroy(p_ps->p_ml_list[i]);
+        if (p_ps->p_restored_mi[i])
+            media_item_unref(p_ps->p_restored_mi[i]);
     }
 
-    /* Clear callback list */
-    if (p_ps->p_cbs_list)
+    /* Clear the subscribers */
+    if (p_ps->p_subscribers)
     {
-        EINA_LIST_FOREACH(p_ps->p_cbs_list, p_el, p_id)
-          free(p_id);
-        eina_list_free(p_ps->p_cbs_list);
+        for (unsigned int i = 0; i < eina_array_count(p_ps->p_subscribers); ++i)
+            free(eina_array_data_get(p_ps->p_subscribers, i));
+        eina_array_free(p_ps->p_subscribers);
     }
+    for (unsigned int i = 0; i < PLAYLIST_CONTEXT_COUNT; ++i)
+        for (unsigned int j = 0; j < PS_EVENT_COUNT; ++j)
+            if (p_ps->p_event_subs[i][j])
+                eina_array_free(p_ps->p_event_subs[i][j]);
+
+    if (p_ps->p_time_job)
+        ecore_job_del(p_ps->p_time_job);
 
+    ps_crossfade_stop(p_ps);
+    ps_gapless_disarm(p_ps);
+    if (p_ps->p_ea_next)
+        ps_emotion_destroy(p_ps, p_ps->p_ea_next);
     if (p_ps->p_ea)
         ps_emotion_destroy(p_ps, p_ps->p_ea);
     if (p_ps->p_ev)
@@ -481,6 +1237,13 @@ playback_service_destroy(playback_service *p_ps)
 
     mini_control_destroy(p_ps->p_minicontrol);
 
+    if (p_ps->p_resume)
+        resume_store_destroy(p_ps->p_resume);
+    eina_stringshare_del(p_ps->psz_resume_mrl);
+
+    free(p_ps->psz_global_options);
+    free(p_ps->psz_media_options);
+    free(p_ps->psz_video_options);
     free(p_ps);
 }
 
@@ -491,10 +1254,18 @@ playback_service_force_restart_emotion(playback_service *p_ps)
     bool is_ea = p_ps->p_e == p_ps->p_ea;
 
     p_ps->b_restart_emotion = false;
+    p_ps->b_refresh_audio = false;
+    p_ps->b_refresh_video = false;
 
     playback_service_stop_notify(p_ps, true);
 
     p_ps->p_e = NULL;
+    if (p_ps->p_ea_next)
+    {
+        /* Will be recreated with the new options when needed */
+        ps_emotion_destroy(p_ps, p_ps->p_ea_next);
+        p_ps->p_ea_next = NULL;
+    }
     if (p_ps->p_ea)
     {
         ps_emotion_destroy(p_ps, p_ps->p_ea);
@@ -509,6 +1280,7 @@ playback_service_force_restart_emotion(playback_service *p_ps)
     p_ps->p_ea = ps_emotion_create(p_ps, p_ps->p_ea_evas, true);
     if (!p_ps->p_ea)
         return -1;
+    ps_options_snapshot(p_ps);
 
     if (p_ps->p_ev_evas)
     {
@@ -543,6 +1315,80 @@ playback_service_restart_emotion(playback_service *p_ps, bool immediate)
     return 0;
 }
 
+/* Recreate the audio emotion objects so that the next media is opened with
+ * the current media options. Only called between two medias. */
+static int
+ps_refresh_audio(playback_service *p_ps)
+{
+    LOGD("Refreshing the audio emotion object");
+
+    p_ps->b_refresh_audio = false;
+
+    ps_crossfade_stop(p_ps);
+    ps_gapless_disarm(p_ps);
+    if (p_ps->p_ea_next)
+    {
+        ps_emotion_destroy(p_ps, p_ps->p_ea_next);
+        p_ps->p_ea_next = NULL;
+    }
+    if (p_ps->p_ea)
+        ps_emotion_destroy(p_ps, p_ps->p_ea);
+
+    p_ps->p_ea = ps_emotion_create(p_ps, p_ps->p_ea_evas, true);
+    if (p_ps->p_e != p_ps->p_ev)
+        p_ps->p_e = p_ps->p_ea;
+
+    return p_ps->p_ea ? 0 : -1;
+}
+
+/* The video emotion object is bound to the video player surface: let the
+ * interface destroy the player, the next one creates a fresh object. */
+static void
+ps_refresh_video(playback_service *p_ps)
+{
+    p_ps->b_refresh_video = false;
+
+    if (p_ps->p_ev == NULL)
+        return;
+
+    LOGD("Releasing the video emotion object");
+    if (p_ps->emotion_restart_cb != NULL)
+        p_ps->emotion_restart_cb(p_ps->emotion_restart_cb_data);
+}
+
+int
+playback_service_apply_options(playback_service *p_ps)
+{
+    char *psz_global = preferences_get_libvlc_global_options();
+    char *psz_media = preferences_get_libvlc_media_options();
+    bool b_global_changed = ps_options_changed(p_ps->psz_global_options, psz_global);
+    bool b_media_changed = ps_options_changed(p_ps->psz_media_options, psz_media);
+
+    free(psz_global);
+    free(psz_media);
+
+    if (b_global_changed)
+        return playback_service_restart_emotion(p_ps, false);
+    if (!b_media_changed)
+        return 0;
+
+    LOGD("libvlc media options changed, applying them on the next media");
+
+    /* The audio objects are recreated right before the next file is opened
+     * by playback_service_start(), without stopping the current media */
+    p_ps->b_refresh_audio = true;
+
+    if (p_ps->p_ev && p_ps->p_e == p_ps->p_ev && p_ps->b_started)
+        p_ps->b_refresh_video = true;
+    else
+        ps_refresh_video(p_ps);
+
+    free(p_ps->psz_media_options);
+    p_ps->psz_media_options = preferences_get_libvlc_media_options();
+
+    return 0;
+}
+
 int
 playback_service_set_context(playback_service *p_ps, enum PLAYLIST_CONTEXT i_ctx)
 {
@@ -569,29 +1415,102 @@ playback_service_get_context(playback_service *p_ps)
 playback_service_cbs_id *
 playback_service_register_callbacks(playback_service *p_ps, playback_service_callbacks *p_cbs)
 {
-    playback_service_callbacks *p_cbs_dup = malloc(sizeof(playback_service_callbacks));
+    ps_subscriber *p_sub = calloc(1, sizeof(ps_subscriber));
 
-    if (!p_cbs_dup)
+    if (!p_sub)
     {
         LOGE("malloc failed");
         return NULL;
     }
-    memcpy(p_cbs_dup, p_cbs, sizeof(playback_service_callbacks));
+    memcpy(&p_sub->cbs, p_cbs, sizeof(playback_service_callbacks));
+    p_sub->b_time_updates = true;
 
-    p_ps->p_cbs_list = eina_list_append(p_ps->p_cbs_list, p_cbs_dup);
-    if (!p_ps->p_cbs_list)
+    if (!eina_array_push(p_ps->p_subscribers, p_sub))
     {
-        free(p_cbs_dup);
+        free(p_sub);
         return NULL;
     }
-    return (playback_service_cbs_id *) p_cbs_dup;
+
+    for (unsigned int i = 0; i < PLAYLIST_CONTEXT_COUNT; ++i)
+    {
+        enum PLAYLIST_CONTEXT i_ctx = i + 1;
+        if (p_cbs->i_ctx != PLAYLIST_CONTEXT_NONE && p_cbs->i_ctx != i_ctx)
+            continue;
+
+        for (unsigned int j = 0; j < PS_EVENT_COUNT; ++j)
+        {
+            if (!ps_subscriber_has_event(p_sub, j))
+                continue;
+            if (!eina_array_push(p_ps->p_event_subs[i][j], p_sub))
+            {
+                playback_service_unregister_callbacks(p_ps, (playback_service_cbs_id *) p_sub);
+                return NULL;
+            }
+        }
+    }
+    return (playback_service_cbs_id *) p_sub;
 }
 
 void
 playback_service_unregister_callbacks(playback_service *p_ps, playback_service_cbs_id *p_id)
 {
-    p_ps->p_cbs_list = eina_list_remove(p_ps->p_cbs_list, p_id);
-    free(p_id);
+    ps_subscriber *p_sub = (ps_subscriber *) p_id;
+
+    /* Freed once no dispatch can reach it anymore */
+    p_sub->b_removed = true;
+    p_ps->b_subs_removed = true;
+    ps_subscribers_compact(p_ps);
+}
+
+void
+playback_service_set_time_updates(playback_service *p_ps, playback_service_cbs_id *p_id, bool b_enabled)
+{
+    ps_subscriber *p_sub = (ps_subscriber *) p_id;
+
+    if (p_sub->b_time_updates == b_enabled)
+        return;
+
+    p_sub->b_time_updates = b_enabled;
+    if (b_enabled)
+    {
+        /* Refresh the labels that were left behind while hidden */
+        p_sub->f_last_time_update = 0.0;
+        ps_time_flush(p_ps);
+    }
+}
+
+void
+playback_service_save_state(playback_service *p_ps)
+{
+    ps_resume_save(p_ps);
+    if (p_ps->p_resume)
+        resume_store_flush(p_ps->p_resume);
+
+    if (p_ps->p_queue_store)
+    {
+        if (p_ps->b_started)
+            queue_store_set_time(p_ps->p_queue_store, p_ps->i_ctx - 1,
+                                 emotion_object_position_get(p_ps->p_e));
+        queue_store_flush(p_ps->p_queue_store);
+    }
+}
+
+void
+playback_service_set_ui_visible(playback_service *p_ps, bool b_visible)
+{
+    if (p_ps->b_ui_visible == b_visible)
+        return;
+
+    p_ps->b_ui_visible = b_visible;
+    if (b_visible)
+    {
+        ps_time_flush(p_ps);
+    }
+    else if (p_ps->p_time_job)
+    {
+        ecore_job_del(p_ps->p_time_job);
+        p_ps->p_time_job = NULL;
+    }
 }
 
 Evas_Object *
@@ -717,6 +1636,23 @@ playback_service_start(playback_service *p_ps, double i_time)
     }
     LOGD("playback_service_start: %s", p_mi->psz_path);
 
+    ps_crossfade_stop(p_ps);
+    ps_gapless_disarm(p_ps);
+
+    /* Leaving the previous media, maybe in the middle */
+    ps_resume_save(p_ps);
+
+    if (p_ps->b_refresh_audio && p_ps->p_e == p_ps->p_ea)
+    {
+        /* Release the previous media before its object goes away */
+        emotion_object_file_set(p_ps->p_e, NULL);
+        if (ps_refresh_audio(p_ps) != 0)
+        {
+            LOGE("unable to recreate the audio emotion object");
+            return -1;
+        }
+    }
+
     // Unset the current file. Because emotion_object_file_set returns EINA_FALSE
     // when reloading the same file, we need to unset it first to allow the REPEAT_ONE
     // function to work.
@@ -727,6 +1663,32 @@ playback_service_start(playback_service *p_ps, double i_time)
         LOGE("emotion_object_file_set failed");
         return -1;
     }
+    eina_stringshare_replace(&p_ps->psz_resume_mrl, p_mi->psz_path);
+
+    if (p_ps->p_e == p_ps->p_ev)
+    {
+        /* Items of the media library know their size, the others get it
+         * from the first calibration measure */
+        ps_video_size_set(p_ps, p_mi->i_w, p_mi->i_h);
+        p_ps->f_calib_nominal_fps = 0.0;
+    }
+
+    /* First start of a restored queue */
+    media_item **pp_restored_mi = &p_ps->p_restored_mi[p_ps->i_ctx - 1];
+    if (*pp_restored_mi)
+    {
+        if (i_time <= 0 && *pp_restored_mi == p_mi)
+            i_time = p_ps->f_restored_time[p_ps->i_ctx - 1];
+        media_item_unref(*pp_restored_mi);
+        *pp_restored_mi = NULL;
+    }
+    if (i_time <= 0 && p_ps->p_resume &&
+        ps_resume_allowed(p_ps, p_mi->i_duration / 1000.0))
+    {
+        i_time = resume_store_get(p_ps->p_resume, p_mi->psz_path);
+        if (i_time > 0)
+            LOGD("resuming %s at %.1fs", p_mi->psz_path, i_time);
+    }
     if (i_time > 0)
         emotion_object_position_set(p_ps->p_e, i_time);
 
@@ -752,6 +1714,9 @@ playback_service_stop_notify(playback_service *p_ps, bool b_notify)
 
     playback_service_pause(p_ps);
     emotion_object_file_set(p_ps->p_e, NULL);
+    ps_crossfade_stop(p_ps);
+    ps_gapless_disarm(p_ps);
+    p_ps->f_transition_start = 0;
     p_ps->b_started = false;
     p_ps->b_video_background = false;
     ps_release_lock(p_ps);
@@ -760,9 +1725,11 @@ playback_service_stop_notify(playback_service *p_ps, bool b_notify)
 
     if (p_ps->b_restart_emotion && !p_ps->b_auto_exit)
         playback_service_force_restart_emotion(p_ps);
+    else if (p_ps->b_refresh_video && !p_ps->b_auto_exit)
+        ps_refresh_video(p_ps);
 
     if (b_notify)
-        PS_SEND_VOID_CALLBACK(pf_on_stopped);
+        PS_SEND_VOID_CALLBACK(PS_EVENT_STOPPED, pf_on_stopped);
 
     mini_control_playing_set(p_ps->p_minicontrol, EINA_FALSE);
     mini_control_visibility_set(p_ps->p_minicontrol, EINA_FALSE);
@@ -792,7 +1759,7 @@ playback_service_play(playback_service *p_ps)
         return -1;
 
     emotion_object_play_set(p_ps->p_e, true);
-    PS_SEND_CALLBACK(pf_on_playpause, true);
+    PS_SEND_CALLBACK(PS_EVENT_PLAYPAUSE, pf_on_playpause, true);
     mini_control_playing_set(p_ps->p_minicontrol, EINA_TRUE);
     return 0;
 }
@@ -803,8 +1770,16 @@ playback_service_pause(playback_service *p_ps)
     if (!p_ps->b_started)
         return -1;
 
+    /* Don't leave the previous media playing alone */
+    ps_crossfade_stop(p_ps);
+
     emotion_object_play_set(p_ps->p_e, false);
-    PS_SEND_CALLBACK(pf_on_playpause, false);
+
+    ps_resume_save(p_ps);
+    if (p_ps->p_resume)
+        resume_store_flush(p_ps->p_resume);
+
+    PS_SEND_CALLBACK(PS_EVENT_PLAYPAUSE, pf_on_playpause, false);
     mini_control_playing_set(p_ps->p_minicontrol, EINA_FALSE);
     return 0;
 }
@@ -818,7 +1793,7 @@ playback_service_toggle_play_pause(playback_service *p_ps)
 
     b_new_state = !emotion_object_play_get(p_ps->p_e);
     emotion_object_play_set(p_ps->p_e, b_new_state);
-    PS_SEND_CALLBACK(pf_on_playpause, b_new_state);
+    PS_SEND_CALLBACK(PS_EVENT_PLAYPAUSE, pf_on_playpause, b_new_state);
     mini_control_playing_set(p_ps->p_minicontrol, b_new_state);
     return b_new_state;
 }
@@ -928,6 +1903,18 @@ playback_service_list_remove_index(playback_service *p_ps, unsigned int i_index)
     return media_list_remove_index(p_ps->p_ml, i_index);
 }
 
+int
+playback_service_list_insert_many(playback_service *p_ps, int i_index, Eina_Array *p_array)
+{
+    return media_list_insert_many(p_ps->p_ml, i_index, p_array);
+}
+
+int
+playback_service_list_replace(playback_service *p_ps, Eina_Array *p_array, int i_pos)
+{
+    return media_list_replace(p_ps->p_ml, p_array, i_pos);
+}
+
 void
 playback_service_list_clear(playback_service *p_ps)
 {
@@ -1044,6 +2031,21 @@ playback_service_get_repeat_mode(playback_service *p_ps)
     return media_list_get_repeat_mode(get_media_list(p_ps, PLAYLIST_CONTEXT_AUDIO));
 }
 
+void
+playback_service_set_shuffle(playback_service *p_ps, bool b_shuffle)
+{
+    /* A new order each time it is enabled */
+    uint64_t i_seed = (uint64_t)(ecore_time_unix_get() * 1000000.0);
+
+    media_list_set_shuffle(get_media_list(p_ps, PLAYLIST_CONTEXT_AUDIO), b_shuffle, i_seed);
+}
+
+bool
+playback_service_get_shuffle(playback_service *p_ps)
+{
+    return media_list_get_shuffle(get_media_list(p_ps, PLAYLIST_CONTEXT_AUDIO));
+}
+
 double
 playback_service_get_play_speed(playback_service *p_ps)
 {
@@ -1064,7 +2066,7 @@ playback_service_enable_background_playback(playback_service *p_ps)
 
     double time = playback_service_get_time(p_ps);
 
-    if (!media_list_copy_list(get_media_list(p_ps, PLAYLIST_CONTEXT_VIDEO), get_media_list(p_ps, PLAYLIST_CONTEXT_AUDIO)))
+    if (media_list_copy_list(get_media_list(p_ps, PLAYLIST_CONTEXT_VIDEO), get_media_list(p_ps, PLAYLIST_CONTEXT_AUDIO)))
         LOGE("Copying video playlist to audio failed");
     if (!playback_service_set_context(p_ps, PLAYLIST_CONTEXT_AUDIO))
         LOGE("Switching from video context to audio failed");
@@ -1099,6 +2101,30 @@ void
 playback_service_eq_set(playback_service* p_ps, float f_preamp, unsigned int i_nb_bands, float* f_bands )
 {
     emotion_object_equalizer_set( p_ps->p_e, f_preamp, i_nb_bands, f_bands );
+    if ( p_ps->p_ea_next != NULL )
+        emotion_object_equalizer_set( p_ps->p_ea_next, f_preamp, i_nb_bands, f_bands );
+}
+
+void
+playback_service_set_crossfade(playback_service *p_ps, double f_duration)
+{
+    if (f_duration < 0.0)
+        f_duration = 0.0;
+    else if (f_duration > PS_CROSSFADE_MAX)
+        f_duration = PS_CROSSFADE_MAX;
+    p_ps->f_crossfade = f_duration;
+}
+
+double
+playback_service_get_crossfade(playback_service *p_ps)
+{
+    return p_ps->f_crossfade;
+}
+
+double
+playback_service_get_last_transition_gap(playback_service *p_ps)
+{
+    return p_ps->f_last_gap_ms;
 }
 
 void
@@ -41,6 +41,9 @@ typedef struct playback_service_callbacks playback_service_callbacks;
 struct playback_service_callbacks
 {
     void (*pf_on_media_added)(playback_service *p_ps, void *p_user_data, unsigned int i_pos, media_item *p_mi);
+    /* i_count medias added at once at i_pos. When NULL, pf_on_media_added is
+     * called for each of them */
+    void (*pf_on_media_range_added)(playback_service *p_ps, void *p_user_data, unsigned int i_pos, unsigned int i_count);
     void (*pf_on_media_removed)(playback_service *p_ps, void *p_user_data, unsigned int i_pos, media_item *p_mi);
     void (*pf_on_media_selected)(playback_service *p_ps, void *p_user_data, unsigned int i_pos, media_item *p_mi);
     void (*pf_on_started)(playback_service *p_ps, void *p_user_data, media_item *p_mi);
@@ -49,6 +52,7 @@ struct playback_service_callbacks
     void (*pf_on_new_len)(playback_service *p_ps, void *p_user_data, double i_len);
     void (*pf_on_new_time)(playback_service *p_ps, void *p_user_data, double i_time, double i_pos);
     void (*pf_on_seek_done)(playback_service *p_ps, void *p_user_data);
+    double f_time_interval;     /* minimum delay between two pf_on_new_time, in seconds */
     void *p_user_data;
     enum PLAYLIST_CONTEXT i_ctx;
 };
@@ -67,6 +71,11 @@ playback_service_destroy(playback_service *p_ps);
 int
 playback_service_restart_emotion(playback_service *p_ps, bool immediate);
 
+/* Apply libvlc options changed in the settings: media options are used from
+ * the next started media, only global ones restart emotion */
+int
+playback_service_apply_options(playback_service *p_ps);
+
 int
 playback_service_set_context(playback_service *p_ps, enum PLAYLIST_CONTEXT i_ctx);
 
@@ -79,6 +88,26 @@ playback_service_register_callbacks(playback_service *p_ps, playback_service_cal
 void
 playback_service_unregister_callbacks(playback_service *p_ps, playback_service_cbs_id *p_id);
 
+/*
+ * Enables or disables pf_on_new_time for a subscriber, e.g. while its view is
+ * hidden. Re-enabling sends the current position right away.
+ */
+void
+playback_service_set_time_updates(playback_service *p_ps, playback_service_cbs_id *p_id, bool b_enabled);
+
+/*
+ * Saves the resume position of the current media, and writes the pending
+ * positions to disk without blocking.
+ */
+void
+playback_service_save_state(playback_service *p_ps);
+
+/*
+ * Stops every pf_on_new_time while the application UI isn't visible.
+ */
+void
+playback_service_set_ui_visible(playback_service *p_ps, bool b_visible);
+
 Evas_Object *
 playback_service_set_evas_video(playback_service *p_ps, Evas *p_evas);
 
@@ -139,6 +168,14 @@ playback_service_list_append(playback_service *p_ps, media_item *p_mi)
     return playback_service_list_insert(p_ps, -1, p_mi);
 }
 
+/* Bulk versions: one notification for all the medias of p_array. The list
+ * takes ownership of the medias, not of the array */
+int
+playback_service_list_insert_many(playback_service *p_ps, int i_index, Eina_Array *p_array);
+
+int
+playback_service_list_replace(playback_service *p_ps, Eina_Array *p_array, int i_pos);
+
 int
 playback_service_list_remove(playback_service *p_ps, media_item *p_mi);
 
@@ -196,6 +233,12 @@ playback_service_set_repeat_mode(playback_service *p_ps, enum PLAYLIST_REPEAT i_
 enum PLAYLIST_REPEAT
 playback_service_get_repeat_mode(playback_service *p_ps);
 
+void
+playback_service_set_shuffle(playback_service *p_ps, bool b_shuffle);
+
+bool
+playback_service_get_shuffle(playback_service *p_ps);
+
 double
 playback_service_get_play_speed(playback_service *p_ps);
 
@@ -220,4 +263,22 @@ playback_service_eq_set(playback_service* p_ps, float f_preamp, unsigned int i_n
 void
 playback_service_eq_get(playback_service* p_ps, float* f_preamp, unsigned int* i_nb_bands, float** f_bands );
 
+/*
+ * Overlaps the end of each audio media with the start of the next one for
+ * f_duration seconds (0 to 12, 0 disables it).
+ */
+void
+playback_service_set_crossfade(playback_service *p_ps, double f_duration);
+
+double
+playback_service_get_crossfade(playback_service *p_ps);
+
+/*
+ * Returns the duration, in ms, between the end of the previous media and the
+ * start of the current one, or -1 if there wasn't any transition yet.
+ * Crossfaded transitions have a 0 gap.
+ */
+double
+playback_service_get_last_transition_gap(playback_service *p_ps);
+
 #endif /* PLAYBACK_SERVICE_H */
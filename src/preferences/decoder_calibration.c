@@ -0,0 +1,153 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+
+#include "common.h"
+
+#include <unistd.h>
+
+#include "preferences/decoder_calibration.h"
+#include "preferences/preferences.h"
+
+/* Below that share of the nominal frame rate, frames are being dropped */
+#define CALIBRATION_MIN_RATIO       0.9
+/* From that share on, the content is played smoothly */
+#define CALIBRATION_SMOOTH_RATIO    0.97
+/* Smooth measures needed before trying a better quality */
+#define CALIBRATION_SMOOTH_REPORTS  30
+
+typedef enum calibration_class
+{
+    CALIBRATION_SD,
+    CALIBRATION_HD,
+    CALIBRATION_FHD,
+    CALIBRATION_UHD,
+    CALIBRATION_CLASS_COUNT,
+} calibration_class;
+
+static const pref_index calibration_prefs[CALIBRATION_CLASS_COUNT] = {
+    PREF_CALIBRATION_SD,
+    PREF_CALIBRATION_HD,
+    PREF_CALIBRATION_FHD,
+    PREF_CALIBRATION_UHD,
+};
+
+/* Only kept for the session: a class that had to be lowered isn't raised
+ * again before the next launch, to avoid oscillating */
+static unsigned int calibration_smooth[CALIBRATION_CLASS_COUNT];
+static bool calibration_lowered[CALIBRATION_CLASS_COUNT];
+
+static calibration_class
+calibration_class_get(int i_w, int i_h)
+{
+    int i_pixels = i_w * i_h;
+
+    if (i_pixels <= 720 * 576)
+        return CALIBRATION_SD;
+    if (i_pixels <= 1280 * 720)
+        return CALIBRATION_HD;
+    if (i_pixels <= 1920 * 1088)
+        return CALIBRATION_FHD;
+    return CALIBRATION_UHD;
+}
+
+/* First guess, before anything was measured: the more cores, the better */
+static int
+calibration_initial_level(calibration_class i_class)
+{
+    long i_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int i_base = i_cores >= 4 ? 0 : i_cores >= 2 ? 1 : 2;
+    int i_level = i_base + i_class;
+
+    return i_level > CALIBRATION_LEVEL_MAX ? CALIBRATION_LEVEL_MAX : i_level;
+}
+
+static int
+calibration_level_get(calibration_class i_class)
+{
+    int i_level = preferences_get_index(calibration_prefs[i_class], -1);
+    if (i_level < 0 || i_level > CALIBRATION_LEVEL_MAX)
+        return -1;
+    return i_level;
+}
+
+void
+decoder_calibration_init(void)
+{
+    for (unsigned int i = 0; i < CALIBRATION_CLASS_COUNT; ++i)
+    {
+        if (calibration_level_get(i) < 0)
+            preferences_set_index(calibration_prefs[i], calibration_initial_level(i));
+    }
+}
+
+int
+decoder_calibration_get_level(int i_w, int i_h)
+{
+    if (i_w <= 0 || i_h <= 0)
+        return CALIBRATION_LEVEL_DEFAULT;
+
+    calibration_class i_class = calibration_class_get(i_w, i_h);
+    int i_level = calibration_level_get(i_class);
+    return i_level >= 0 ? i_level : calibration_initial_level(i_class);
+}
+
+void
+decoder_calibration_report(int i_w, int i_h, int i_level, double f_fps, double f_nominal_fps)
+{
+    if (i_w <= 0 || i_h <= 0 || f_nominal_fps <= 0)
+        return;
+
+    calibration_class i_class = calibration_class_get(i_w, i_h);
+    int i_current = decoder_calibration_get_level(i_w, i_h);
+
+    /* Decoded with the level of another class, or before it changed */
+    if (i_level != i_current)
+        return;
+
+    /* Relative to the rate of the video, so that 12 or 15 fps videos
+     * aren't mistaken for dropped frames */
+    double f_ratio = f_fps / f_nominal_fps;
+    if (f_ratio < CALIBRATION_MIN_RATIO)
+    {
+        calibration_smooth[i_class] = 0;
+        if (i_current < CALIBRATION_LEVEL_MAX)
+        {
+            LOGD("calibration: %dx%d decoded at %.1f of %.1f fps, lowering the quality to %d",
+                 i_w, i_h, f_fps, f_nominal_fps, i_current + 1);
+            preferences_set_index(calibration_prefs[i_class], i_current + 1);
+            calibration_lowered[i_class] = true;
+        }
+    }
+    else if (f_ratio >= CALIBRATION_SMOOTH_RATIO && i_current > 0 && !calibration_lowered[i_class])
+    {
+        if (++calibration_smooth[i_class] >= CALIBRATION_SMOOTH_REPORTS)
+        {
+            LOGD("calibration: %dx%d decoded smoothly, raising the quality to %d",
+                 i_w, i_h, i_current - 1);
+            preferences_set_index(calibration_prefs[i_class], i_current - 1);
+            calibration_smooth[i_class] = 0;
+        }
+    }
+}
@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * Copyright © 2015-2016 VideoLAN, VideoLabs SAS
+ *****************************************************************************
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+/*
+ * By committing to this project, you allow VideoLAN and VideoLabs to relicense
+ * the code to a different OSI approved license, in case it is required for
+ * compatibility with the Store
+ *****************************************************************************/
+
+
+#ifndef DECODER_CALIBRATION_H_
+#define DECODER_CALIBRATION_H_
+
+#include "common.h"
+
+/*
+ * Decoding quality used by the automatic deblocking setting, calibrated per
+ * resolution class from the frame rates measured while playing videos.
+ *
+ * Levels go from the best quality to the fastest decoding:
+ *  0: full deblocking, 1: medium, 2: low, 3: none,
+ *  4: none, and skipped frames and IDCT
+ */
+#define CALIBRATION_LEVEL_MAX       4
+/* Used when the size of the media isn't known */
+#define CALIBRATION_LEVEL_DEFAULT   2
+
+/* Stores the first guess of the classes that were never calibrated */
+void
+decoder_calibration_init(void);
+
+int
+decoder_calibration_get_level(int i_w, int i_h);
+
+/*
+ * Reports the frame rate sustained while playing a i_w x i_h video decoded
+ * at i_level, and the nominal frame rate of the video. The level of its class
+ * is raised when the device can't keep up, and lowered again after a while
+ * of smooth playback.
+ */
+void
+decoder_calibration_report(int i_w, int i_h, int i_level, double f_fps, double f_nominal_fps);
+
+#endif /* DECODER_CALIBRATION_H_ */
@@ -25,6 +25,7 @@
  *****************************************************************************/
 
 #include "preferences/preferences.h"
+#include "preferences/decoder_calibration.h"
 #include "ui/settings/menu_id.h"
 #include <app_preference.h>
 
@@ -51,6 +52,11 @@ pref_key_id_map mapping[] =
         // type index
         {{.t_index = PREF_SUBSENC}, "SUBSENC"},
         {{.t_index = PREF_CURRENT_VIEW}, "CURRENT_VIEW"},
+        {{.t_index = PREF_CROSSFADE}, "CROSSFADE"},
+        {{.t_index = PREF_CALIBRATION_SD}, "CALIBRATION_SD"},
+        {{.t_index = PREF_CALIBRATION_HD}, "CALIBRATION_HD"},
+        {{.t_index = PREF_CALIBRATION_FHD}, "CALIBRATION_FHD"},
+        {{.t_index = PREF_CALIBRATION_UHD}, "CALIBRATION_UHD"},
 
         // type bool
         {{.t_bool = PREF_FRAME_SKIP}, "FRAME_SKIP"},
@@ -138,10 +144,20 @@ preferences_get_bool(pref_bool key, bool default_value)
     return value;
 }
 
+/* Options that only affect how a media is decoded or output. Changing them
+ * does not require a new libvlc instance: a fresh emotion object picks them
+ * up for the next media. */
 char *
-preferences_get_libvlc_options()
+preferences_get_libvlc_media_options()
+{
+    return preferences_get_libvlc_media_options_for_size(0, 0);
+}
+
+char *
+preferences_get_libvlc_media_options_for_size(int i_w, int i_h)
 {
-    char *buf = calloc(512, sizeof(char));
+    bool b_frame_skip = preferences_get_bool(PREF_FRAME_SKIP, false);
+    char *buf = calloc(256, sizeof(char));
     if (buf == NULL)
         return NULL;
 
@@ -169,15 +185,40 @@ preferences_get_libvlc_options()
         break;
     case DEBLOCKING_AUTOMATIC:
     default:
-        //TODO add auto-detection based on device performances
-        strcat(buf, "3 ");
+    {
+        int i_level = decoder_calibration_get_level(i_w, i_h);
+        if (i_level == CALIBRATION_LEVEL_MAX)
+        {
+            strcat(buf, "4 ");
+            b_frame_skip = true;
+        }
+        else
+        {
+            /* Levels 0 to 3 match the full to no deblocking settings */
+            char psz_level[4];
+            snprintf(psz_level, sizeof(psz_level), "%d ", i_level + 1);
+            strcat(buf, psz_level);
+        }
         break;
     }
+    }
 
-    if (preferences_get_bool(PREF_FRAME_SKIP, false))
-        strcat(buf, "--avcodec-skip-frame 2 --avcodec-skip-idct 2 ");
+    if (b_frame_skip)
+        strcat(buf, "--avcodec-skip-frame 2 --avcodec-skip-idct 2");
     else
-        strcat(buf, "--avcodec-skip-frame 0 --avcodec-skip-idct 0 ");
+        strcat(buf, "--avcodec-skip-frame 0 --avcodec-skip-idct 0");
+
+    return buf;
+}
+
+/* Options that configure the libvlc instance itself (logging, modules).
+ * Changing them requires restarting every emotion object. */
+char *
+preferences_get_libvlc_global_options()
+{
+    char *buf = calloc(256, sizeof(char));
+    if (buf == NULL)
+        return NULL;
 
     strcat(buf, "--subsdec-encoding system "); //TODO find a way to pass the value
     strcat(buf, "--stats ");
@@ -188,3 +229,18 @@ preferences_get_libvlc_options()
 
     return buf;
 }
+
+char *
+preferences_get_libvlc_options()
+{
+    char *psz_media = preferences_get_libvlc_media_options();
+    char *psz_global = preferences_get_libvlc_global_options();
+    char *buf = NULL;
+
+    if (psz_media && psz_global && asprintf(&buf, "%s %s", psz_media, psz_global) < 0)
+        buf = NULL;
+
+    free(psz_media);
+    free(psz_global);
+    return buf;
+}
@@ -41,6 +41,11 @@ typedef enum pref_enum {
 typedef enum pref_index {
     PREF_SUBSENC = 2000,
     PREF_CURRENT_VIEW,
+    PREF_CROSSFADE,         /* in seconds */
+    PREF_CALIBRATION_SD,    /* decoder_calibration levels */
+    PREF_CALIBRATION_HD,
+    PREF_CALIBRATION_FHD,
+    PREF_CALIBRATION_UHD,
 } pref_index;
 
 typedef enum pref_bool {
@@ -72,4 +77,15 @@ preferences_get_bool(pref_bool key, bool default_value);
 char *
 preferences_get_libvlc_options();
 
+char *
+preferences_get_libvlc_media_options();
+
+/* Media options for a video of that size, 0 if unknown: the automatic
+ * deblocking setting depends on it */
+char *
+preferences_get_libvlc_media_options_for_size(int i_w, int i_h);
+
+char *
+preferences_get_libvlc_global_options();
+
 #endif
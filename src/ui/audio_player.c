@@ -46,7 +46,7 @@ struct audio_player {
     playlists *p_playlists;
     equalizer* p_equalizer;
 
-    bool save_state, shuffle_state, playlist_state, more_state, fs_state;
+    bool save_state, playlist_state, more_state, fs_state;
     double slider_event_time;
 
 
@@ -409,12 +409,21 @@ player_update_sliders(audio_player *mpd, double i_pos)
         elm_slider_value_set (mpd->fs_slider, i_pos);
 }
 
+/* Only ask for position updates while the mini or fullscreen player shows them */
+static void
+audio_player_update_time_updates(audio_player *mpd)
+{
+    bool b_visible = mpd->fs_state || intf_mini_player_visible_get(mpd->intf);
+
+    if (mpd->p_ps_cbs_id)
+        playback_service_set_time_updates(mpd->p_ps, mpd->p_ps_cbs_id, b_visible);
+}
+
 static void
 audio_player_reset_states(audio_player *mpd)
 {
     mpd->fs_state = false;
     mpd->save_state = false;
-    mpd->shuffle_state = false;
     mpd->playlist_state = false;
     mpd->more_state = false;
 }
@@ -444,7 +453,7 @@ bool
 audio_player_shuffle_state(audio_player *mpd)
 {
     /* Return the current shuffle state*/
-    return mpd->shuffle_state;
+    return playback_service_get_shuffle(mpd->p_ps);
 }
 
 bool
@@ -818,8 +827,8 @@ fs_shuffle_player_cb(void *data, Evas_Object *obj EINA_UNUSED, void *event_info)
         /* */
         evas_object_show(mpd->fs_shuffle_btn);
 
-        /* Update the shuffle button state of the player */
-        mpd->shuffle_state = true;
+        /* Update the shuffle state of the player */
+        playback_service_set_shuffle(mpd->p_ps, true);
     }
     else
     {
@@ -828,8 +837,8 @@ fs_shuffle_player_cb(void *data, Evas_Object *obj EINA_UNUSED, void *event_info)
         /* */
         evas_object_show(mpd->fs_shuffle_btn);
 
-        /* Update the shuffle button state of the player */
-        mpd->shuffle_state = false;
+        /* Update the shuffle state of the player */
+        playback_service_set_shuffle(mpd->p_ps, false);
     }
 }
 
@@ -899,6 +908,7 @@ audio_player_collapse_fullscreen_player(audio_player *mpd){
     mpd->fs_state = false;
     /* Show the mini player */
     intf_mini_player_visible_set(mpd->intf, true);
+    audio_player_update_time_updates(mpd);
 
     Evas_Object *win = intf_get_window(mpd->intf);
     if (elm_win_wm_rotation_supported_get(win)) {
@@ -987,7 +997,7 @@ add_fullscreen_item_table(audio_player *mpd, Evas_Object *parent)
     elm_object_part_content_set(layout, "repeat_button", mpd->fs_repeat_btn);
 
     /* Shuffle */
-    if (mpd->shuffle_state == FALSE){
+    if (audio_player_shuffle_state(mpd) == false){
         mpd->fs_shuffle_btn = create_icon(parent, "ic_shuffle_normal.png");
     }
     else {
@@ -1027,6 +1037,7 @@ audio_player_show_fullscreen(audio_player *mpd)
 
     /* Update fullscreen state bool */
     mpd->fs_state = true;
+    audio_player_update_time_updates(mpd);
 }
 
 static void
@@ -1070,12 +1081,26 @@ ps_on_new_len_cb(playback_service *p_ps, void *p_user_data, double i_len)
         evas_change_time(mpd->fs_total_time, i_len);
 }
 
+static void
+audio_player_show_mini_player(audio_player *mpd)
+{
+    /* Show the mini player only if it isn't already shown */
+    if (intf_mini_player_visible_get(mpd->intf) == false && audio_player_fs_state(mpd) == false){
+        intf_mini_player_visible_set(mpd->intf, true);
+        audio_player_update_time_updates(mpd);
+    }
+}
+
 static void
 ps_on_media_selected_cb(playback_service *p_ps, void *p_user_data, unsigned int i_pos, media_item *p_mi)
 {
     audio_player *mpd = p_user_data;
 
     update_player_display(mpd);
+
+    /* A queue restored at startup can be resumed from the mini player */
+    if (p_mi && !playback_service_is_started(p_ps) && !mpd->mini_player_hide_timer)
+        audio_player_show_mini_player(mpd);
 }
 
 static void
@@ -1084,14 +1109,13 @@ ps_on_started_cb(playback_service *p_ps, void *p_user_data, media_item *p_mi)
     audio_player *mpd = p_user_data;
 
     if (mpd->mini_player_hide_timer)
+    {
         ecore_timer_del(mpd->mini_player_hide_timer);
+        mpd->mini_player_hide_timer = NULL;
+    }
 
     update_player_display(mpd);
-
-    /* Show the mini player only if it isn't already shown */
-    if (intf_mini_player_visible_get(mpd->intf) == false && audio_player_fs_state(mpd) == false){
-        intf_mini_player_visible_set(mpd->intf, true);
-    }
+    audio_player_show_mini_player(mpd);
 }
 
 static void
@@ -1113,20 +1137,9 @@ audio_player_start(audio_player *mpd, Eina_Array *array, int pos)
     audio_player_reset_states(mpd);
 
     playback_service_set_context(mpd->p_ps, PLAYLIST_CONTEXT_AUDIO);
-    playback_service_list_clear(mpd->p_ps);
-
-    media_item *p_mi;
-    Eina_Array_Iterator iterator;
-    unsigned int i;
-
-    EINA_ARRAY_ITER_NEXT(array, i, p_mi, iterator)
-    {
-        playback_service_list_append(mpd->p_ps, p_mi);
-    }
-
+    playback_service_list_replace(mpd->p_ps, array, pos);
     eina_array_free(array);
 
-    playback_service_list_set_pos(mpd->p_ps, pos);
     playback_service_start(mpd->p_ps, 0);
 
     update_player_display(mpd);
@@ -1151,6 +1164,7 @@ audio_player_create(interface *intf, playback_service *p_ps, Evas_Object *layout
 
     playback_service_callbacks cbs = {
         .pf_on_media_added = NULL,
+        .pf_on_media_range_added = NULL,
         .pf_on_media_removed = NULL,
         .pf_on_media_selected = ps_on_media_selected_cb,
         .pf_on_started = ps_on_started_cb,
@@ -1159,6 +1173,7 @@ audio_player_create(interface *intf, playback_service *p_ps, Evas_Object *layout
         .pf_on_new_len = ps_on_new_len_cb,
         .pf_on_new_time = ps_on_new_time_cb,
         .pf_on_seek_done = NULL,
+        .f_time_interval = 0.5,
         .p_user_data = mpd,
         .i_ctx = PLAYLIST_CONTEXT_AUDIO,
     };
@@ -1189,8 +1204,11 @@ audio_player_mini_hide_cb(void *data)
 {
     audio_player *mpd = data;
 
+    mpd->mini_player_hide_timer = NULL;
+
     /* Hide the player */
     intf_mini_player_visible_set(mpd->intf, false);
+    audio_player_update_time_updates(mpd);
 
     return ECORE_CALLBACK_CANCEL;
 }
@@ -1208,6 +1226,7 @@ audio_player_stop_delay_ui(audio_player *mpd, bool delayed)
     {
         /* Hide the player */
         intf_mini_player_visible_set(mpd->intf, false);
+        audio_player_update_time_updates(mpd);
     }
     else
     {
@@ -145,9 +145,14 @@ typedef struct list_view
     audio_view_type type;
     void            (*pf_del)(list_sys* p_sys);
     list_view_item* (*pf_append_item)(list_sys* p_sys, void* p_item);
+    /* Inserts the item before p_before, or at the end of the list if it is NULL */
+    list_view_item* (*pf_insert_item)(list_sys* p_sys, void* p_item, list_view_item* p_before);
+    /* Inserts a batch of items before p_before, returns the created view items */
+    Eina_List*      (*pf_insert_items)(list_sys* p_sys, Eina_List* p_items, list_view_item* p_before);
     void            (*pf_clear)(list_sys* p_sys);
     const void*     (*pf_get_item)(list_view_item* p_list_item);
     void            (*pf_set_item)(list_view_item* p_list_item, void* p_item);
+    void            (*pf_remove_item)(list_sys* p_sys, list_view_item* p_list_item);
     Evas_Object*    (*pf_get_widget)(list_sys* p_sys);
     Evas_Object*    (*pf_get_list)(list_sys* p_list_sys);
     bool            (*pf_view_event_back)(list_sys* p_sys);
@@ -37,6 +37,7 @@ typedef enum menu_id
     SETTINGS_ID_VORIENTATION,
     SETTINGS_ID_PERFORMANCES,
     SETTINGS_ID_DEBLOCKING,
+    SETTINGS_ID_CROSSFADE,
     SETTINGS_ID_DEVELOPER,
 
     /* Submenu */
@@ -67,6 +68,14 @@ typedef enum menu_id
 
     DEVELOPER_VERBOSE = 6000,
 
+    CROSSFADE_DISABLED = 7000,
+    CROSSFADE_2S,
+    CROSSFADE_4S,
+    CROSSFADE_6S,
+    CROSSFADE_8S,
+    CROSSFADE_10S,
+    CROSSFADE_12S,
+
 } menu_id;
 
 #endif
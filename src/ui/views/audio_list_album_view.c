@@ -132,12 +132,13 @@ static void
 audio_list_album_item_set_media_item(list_view_item* p_view_item, void* p_data)
 {
     album_item* p_media_item = (album_item*)p_data;
+    album_item_destroy(p_view_item->p_album_item);
     p_view_item->p_album_item = p_media_item;
-    ecore_main_loop_thread_safe_call_async((Ecore_Cb)elm_genlist_item_update, p_view_item->p_object_item);
+    elm_genlist_item_update(p_view_item->p_object_item);
 }
 
 static list_view_item*
-audio_list_album_view_append_item(list_sys *p_list_sys, void* p_data)
+audio_list_album_view_insert_item(list_sys *p_list_sys, void* p_data, list_view_item* p_before)
 {
     album_item* p_album_item = (album_item*)p_data;
     list_view_item *p_view_item = calloc(1, sizeof(*p_view_item));
@@ -146,24 +147,27 @@ audio_list_album_view_append_item(list_sys *p_list_sys, void* p_data)
 
     p_view_item->p_album_item = p_album_item;
 
-    /* Set and append new item in the genlist */
-    Elm_Object_Item *it = elm_genlist_item_append(p_list_sys->p_list,
-            p_list_sys->p_default_item_class,           /* genlist item class               */
-            p_view_item,                                /* genlist item class user data     */
-            NULL,                                       /* genlist parent item              */
-            ELM_GENLIST_ITEM_NONE,                      /* genlist item type                */
-            audio_list_album_item_selected,             /* genlist select smart callback    */
-            p_view_item);                               /* genlist smart callback user data */
+    /* Set and insert new item in the genlist */
+    Elm_Object_Item *it = list_view_insert_object_item(p_list_sys, p_list_sys->p_default_item_class, p_view_item,
+            audio_list_album_item_selected, p_before != NULL ? p_before->p_object_item : NULL);
 
     /* */
+    p_view_item->p_object_item = it;
     elm_object_item_del_cb_set(it, free_list_item_data);
     list_view_toggle_empty(p_list_sys, false);
     return p_view_item;
 }
 
+static void
+audio_list_album_view_remove_item(list_sys* p_list_sys, list_view_item* p_view_item)
+{
+    list_view_remove_object_item(p_list_sys, p_view_item->p_object_item);
+}
+
 static void
 audio_list_album_view_delete(list_sys* p_list_sys)
 {
+    list_view_common_release(p_list_sys);
     media_library_controller_destroy(p_list_sys->p_ctrl);
     elm_genlist_item_class_free(p_list_sys->p_default_item_class);
     free(p_list_sys);
@@ -199,14 +203,18 @@ audio_list_album_view_create(interface* p_intf, Evas_Object* p_parent, unsigned
     p_list_sys->p_default_item_class->func.text_get = genlist_text_get_cb;
     p_list_sys->p_default_item_class->func.content_get = genlist_content_get_cb;
 
-    p_list_view->pf_append_item = &audio_list_album_view_append_item;
+    p_list_view->pf_insert_item = &audio_list_album_view_insert_item;
     p_list_view->pf_get_item = &audio_list_album_item_get_media_item;
     p_list_view->pf_set_item = &audio_list_album_item_set_media_item;
+    p_list_view->pf_remove_item = &audio_list_album_view_remove_item;
     p_list_view->pf_del = &audio_list_album_view_delete;
 
     application* p_app = intf_get_application( p_intf );
     p_list_sys->p_ctrl = album_controller_create(p_app, p_list_view);
     media_library_controller_set_content_callback(p_list_sys->p_ctrl, audio_list_album_get_albums_cb, p_list_sys);
+    /* The content callback resets the sort: only an artist's albums keep the library order */
+    if (i_artist_id == 0)
+        media_library_controller_set_sort(p_list_sys->p_ctrl, ML_SORT_TITLE);
     media_library_controller_refresh(p_list_sys->p_ctrl);
     return p_list_view;
 }
@@ -124,12 +124,13 @@ static void
 audio_list_artist_item_set_media_item(list_view_item* p_view_item, void* p_data)
 {
     artist_item* p_media_item = (artist_item*)p_data;
+    artist_item_destroy(p_view_item->p_artist_item);
     p_view_item->p_artist_item = p_media_item;
-    ecore_main_loop_thread_safe_call_async((Ecore_Cb)elm_genlist_item_update, p_view_item->p_object_item);
+    elm_genlist_item_update(p_view_item->p_object_item);
 }
 
 static list_view_item*
-audio_list_artist_view_append_item(list_sys *p_sys, void* p_data)
+audio_list_artist_view_insert_item(list_sys *p_sys, void* p_data, list_view_item* p_before)
 {
     artist_item* p_artist_item = (artist_item*)p_data;
     list_view_item *p_view_item = calloc(1, sizeof(*p_view_item));
@@ -138,21 +139,23 @@ audio_list_artist_view_append_item(list_sys *p_sys, void* p_data)
 
     p_view_item->p_artist_item = p_artist_item;
 
-    /* Set and append new item in the genlist */
-    Elm_Object_Item *it = elm_genlist_item_append(p_sys->p_list,
-            p_sys->p_default_item_class,                /* genlist item class               */
-            p_view_item,                                /* genlist item class user data     */
-            NULL,                                       /* genlist parent item              */
-            ELM_GENLIST_ITEM_NONE,                      /* genlist item type                */
-            audio_list_artist_item_selected,            /* genlist select smart callback    */
-            p_view_item);                               /* genlist smart callback user data */
+    /* Set and insert new item in the genlist */
+    Elm_Object_Item *it = list_view_insert_object_item(p_sys, p_sys->p_default_item_class, p_view_item,
+            audio_list_artist_item_selected, p_before != NULL ? p_before->p_object_item : NULL);
 
     /* */
+    p_view_item->p_object_item = it;
     elm_object_item_del_cb_set(it, free_list_item_data);
     list_view_toggle_empty(p_sys, false);
     return p_view_item;
 }
 
+static void
+audio_list_artist_view_remove_item(list_sys* p_list_sys, list_view_item* p_view_item)
+{
+    list_view_remove_object_item(p_list_sys, p_view_item->p_object_item);
+}
+
 list_view*
 audio_list_artist_view_create(interface* p_intf, Evas_Object* p_parent, list_view_create_option opts)
 {
@@ -172,9 +175,10 @@ audio_list_artist_view_create(interface* p_intf, Evas_Object* p_parent, list_vie
     p_list_sys->p_default_item_class->func.text_get = genlist_text_get_cb;
     p_list_sys->p_default_item_class->func.content_get = genlist_content_get_cb;
 
-    p_list_view->pf_append_item = &audio_list_artist_view_append_item;
+    p_list_view->pf_insert_item = &audio_list_artist_view_insert_item;
     p_list_view->pf_get_item = &audio_list_artist_item_get_media_item;
     p_list_view->pf_set_item = &audio_list_artist_item_set_media_item;
+    p_list_view->pf_remove_item = &audio_list_artist_view_remove_item;
 
     application* p_app = intf_get_application( p_intf );
     p_list_sys->p_ctrl = artist_controller_create(p_app, p_list_view);
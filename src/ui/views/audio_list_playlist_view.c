@@ -91,8 +91,9 @@ static void
 audio_list_playlists_item_set_playlist_item(list_view_item* p_item, void* p_data)
 {
     playlist_item *p_playlist_item = (playlist_item*)p_data;
+    playlist_item_destroy(p_item->p_playlist_item);
     p_item->p_playlist_item = p_playlist_item;
-    ecore_main_loop_thread_safe_call_async((Ecore_Cb)elm_genlist_item_update, p_item->p_object_item);
+    elm_genlist_item_update(p_item->p_object_item);
 }
 
 static Evas_Object*
@@ -141,7 +142,7 @@ audio_list_playlists_item_selected(void *data, Evas_Object *obj, void *event_inf
 }
 
 static list_view_item*
-audio_list_playlists_view_append_item(list_sys *p_sys, void* p_data)
+audio_list_playlists_view_insert_item(list_sys *p_sys, void* p_data, list_view_item* p_before)
 {
     playlist_item* p_playlist_item = (playlist_item*)p_data;
     list_view_item *ali = calloc(1, sizeof(*ali));
@@ -150,24 +151,27 @@ audio_list_playlists_view_append_item(list_sys *p_sys, void* p_data)
 
     ali->p_playlist_item = p_playlist_item;
 
-    /* Set and append new item in the genlist */
-    Elm_Object_Item *it = elm_genlist_item_append(p_sys->p_list,
-            p_sys->p_default_item_class,                /* genlist item class               */
-            ali,                                        /* genlist item class user data     */
-            NULL,                                       /* genlist parent item              */
-            ELM_GENLIST_ITEM_NONE,                      /* genlist item type                */
-            p_sys->pf_selected,                         /* genlist select smart callback    */
-            ali);                                       /* genlist smart callback user data */
+    /* Set and insert new item in the genlist */
+    Elm_Object_Item *it = list_view_insert_object_item(p_sys, p_sys->p_default_item_class, ali,
+            p_sys->pf_selected, p_before != NULL ? p_before->p_object_item : NULL);
 
     /* */
+    ali->p_object_item = it;
     elm_object_item_del_cb_set(it, free_list_item_data);
     list_view_toggle_empty(p_sys, false);
     return ali;
 }
 
+static void
+audio_list_playlists_view_remove_item(list_sys* p_list_sys, list_view_item* p_view_item)
+{
+    list_view_remove_object_item(p_list_sys, p_view_item->p_object_item);
+}
+
 static void
 audio_list_playlists_view_delete(list_sys* p_list_sys)
 {
+    list_view_common_release(p_list_sys);
     media_library_controller_destroy(p_list_sys->p_ctrl);
     elm_genlist_item_class_free(p_list_sys->p_default_item_class);
     free(p_list_sys);
@@ -252,9 +256,10 @@ audio_list_playlists_view_create_private(interface* p_intf, Evas_Object* p_paren
     evas_object_size_hint_weight_set(p_sys->p_list, EVAS_HINT_EXPAND, EVAS_HINT_EXPAND);
     evas_object_size_hint_align_set(p_sys->p_list, EVAS_HINT_FILL, EVAS_HINT_FILL);
 
-    p_view->pf_append_item = &audio_list_playlists_view_append_item;
+    p_view->pf_insert_item = &audio_list_playlists_view_insert_item;
     p_view->pf_get_item = &audio_list_playlists_item_get_playlist_item;
     p_view->pf_set_item = &audio_list_playlists_item_set_playlist_item;
+    p_view->pf_remove_item = &audio_list_playlists_view_remove_item;
     p_view->pf_del = &audio_list_playlists_view_delete;
     p_view->pf_view_event_back = &audio_list_playlists_back_callback;
 
@@ -106,8 +106,9 @@ static void
 audio_list_song_item_set_media_item(list_view_item* p_item, void* p_data)
 {
     media_item *p_media_item = (media_item*)p_data;
+    media_item_destroy(p_item->p_media_item);
     p_item->p_media_item = p_media_item;
-    ecore_main_loop_thread_safe_call_async((Ecore_Cb)elm_genlist_item_update, p_item->p_object_item);
+    elm_genlist_item_update(p_item->p_object_item);
 }
 
 static Evas_Object*
@@ -163,7 +164,7 @@ genlist_selected_cb(void *data, Evas_Object *obj EINA_UNUSED, void *event_info)
         if (media_item_identical(lvi->p_media_item, ali->p_media_item))
             pos = index;
 
-        eina_array_push(array, media_item_copy(lvi->p_media_item));
+        eina_array_push(array, media_item_ref(lvi->p_media_item));
         index++;
     } while ((it = elm_genlist_item_next_get(it)) != NULL);
 
@@ -262,7 +263,7 @@ audio_list_song_longpress_callback(void *data, Evas_Object *obj, void *event_inf
 }
 
 static list_view_item*
-audio_list_song_view_append_item(list_sys *p_sys, void* p_data)
+audio_list_song_view_insert_item(list_sys *p_sys, void* p_data, list_view_item* p_before)
 {
     media_item* p_media_item = (media_item*)p_data;
     list_view_item *ali = calloc(1, sizeof(*ali));
@@ -271,24 +272,27 @@ audio_list_song_view_append_item(list_sys *p_sys, void* p_data)
 
     ali->p_media_item = p_media_item;
 
-    /* Set and append new item in the genlist */
-    Elm_Object_Item *it = elm_genlist_item_append(p_sys->p_list,
-            p_sys->p_default_item_class,                /* genlist item class               */
-            ali,                                        /* genlist item class user data     */
-            NULL,                                       /* genlist parent item              */
-            ELM_GENLIST_ITEM_NONE,                      /* genlist item type                */
-            genlist_selected_cb,                        /* genlist select smart callback    */
-            ali);                                       /* genlist smart callback user data */
+    /* Set and insert new item in the genlist */
+    Elm_Object_Item *it = list_view_insert_object_item(p_sys, p_sys->p_default_item_class, ali,
+            genlist_selected_cb, p_before != NULL ? p_before->p_object_item : NULL);
 
     /* */
+    ali->p_object_item = it;
     elm_object_item_del_cb_set(it, free_list_item_data);
     list_view_toggle_empty(p_sys, false);
     return ali;
 }
 
+static void
+audio_list_song_view_remove_item(list_sys* p_list_sys, list_view_item* p_view_item)
+{
+    list_view_remove_object_item(p_list_sys, p_view_item->p_object_item);
+}
+
 static void
 audio_list_song_view_delete(list_sys* p_list_sys)
 {
+    list_view_common_release(p_list_sys);
     media_library_controller_destroy(p_list_sys->p_ctrl);
     elm_genlist_item_class_free(p_list_sys->p_default_item_class);
     free(p_list_sys);
@@ -343,9 +347,10 @@ audio_list_song_view_create(interface* p_intf, Evas_Object* p_parent, list_view_
     evas_object_size_hint_align_set(p_sys->p_list, EVAS_HINT_FILL, EVAS_HINT_FILL);
     evas_object_smart_callback_add(p_sys->p_list, "longpressed", audio_list_song_longpress_callback, p_sys);
 
-    p_view->pf_append_item = &audio_list_song_view_append_item;
+    p_view->pf_insert_item = &audio_list_song_view_insert_item;
     p_view->pf_get_item = &audio_list_song_item_get_media_item;
     p_view->pf_set_item = &audio_list_song_item_set_media_item;
+    p_view->pf_remove_item = &audio_list_song_view_remove_item;
     p_view->pf_del = &audio_list_song_view_delete;
     p_view->pf_view_event_back = &audio_list_song_back_callback;
 
@@ -380,6 +385,7 @@ audio_list_song_view_album_create(interface* p_intf, Evas_Object* p_parent, unsi
     list_view* p_view = audio_list_song_view_create(p_intf, p_parent, opts);
     p_view->p_sys->i_album_id = i_album_id;
     media_library_controller_set_content_callback(p_view->p_sys->p_ctrl, audio_list_song_get_album_songs_cb, p_view->p_sys);
+    media_library_controller_set_sort(p_view->p_sys->p_ctrl, ML_SORT_TRACK_NUMBER);
     media_library_controller_refresh(p_view->p_sys->p_ctrl);
     return p_view;
 }
@@ -44,6 +44,7 @@ list_view_clear(list_sys* p_list_sys)
 static void
 list_view_destroy(list_sys* p_list_sys)
 {
+    list_view_common_release(p_list_sys);
     media_library_controller_destroy(p_list_sys->p_ctrl);
     elm_genlist_item_class_free(p_list_sys->p_default_item_class);
     free(p_list_sys);
@@ -61,9 +62,50 @@ list_view_get_list(list_sys* p_list_sys)
     return p_list_sys->p_list;
 }
 
+static list_view_item*
+list_view_append_item(list_sys* p_list_sys, void* p_item)
+{
+    return p_list_sys->p_view->pf_insert_item(p_list_sys, p_item, NULL);
+}
+
+/*
+ * Inserts a whole batch of items before p_before (NULL meaning the end of the
+ * list) through the view's pf_insert_item, and only updates the empty state
+ * once all of them have been inserted.
+ * Returns the list of created view items.
+ */
+static Eina_List*
+list_view_insert_items(list_sys* p_list_sys, Eina_List* p_items, list_view_item* p_before)
+{
+    Eina_List* p_view_items = NULL;
+    Eina_List* it;
+    void* p_item;
+
+    if (p_items == NULL)
+        return NULL;
+
+    p_list_sys->b_in_batch = true;
+    p_list_sys->b_batch_empty = p_list_sys->b_empty;
+    EINA_LIST_FOREACH(p_items, it, p_item)
+    {
+        list_view_item* p_view_item = p_list_sys->p_view->pf_insert_item(p_list_sys, p_item, p_before);
+        if (p_view_item != NULL)
+            p_view_items = eina_list_append(p_view_items, p_view_item);
+    }
+    p_list_sys->b_in_batch = false;
+    list_view_toggle_empty(p_list_sys, p_list_sys->b_batch_empty);
+    return p_view_items;
+}
+
 void
 list_view_toggle_empty(list_sys* p_list_sys, bool b_empty)
 {
+    if (p_list_sys->b_in_batch)
+    {
+        // Defer the actual update to the end of the batch
+        p_list_sys->b_batch_empty = b_empty;
+        return;
+    }
     if (p_list_sys->b_empty == b_empty)
         return;
     p_list_sys->b_empty = b_empty;
@@ -77,11 +119,62 @@ list_view_toggle_empty(list_sys* p_list_sys, bool b_empty)
     evas_object_hide(p_hide);
 }
 
+/*
+ * Appends a genlist item, or inserts it right before p_before if it isn't NULL.
+ * p_data is used both as the item data and the selection callback data.
+ */
+Elm_Object_Item*
+list_view_insert_object_item(list_sys* p_list_sys, const Elm_Genlist_Item_Class* itc, void* p_data, Evas_Smart_Cb pf_selected, Elm_Object_Item* p_before)
+{
+    if (p_before == NULL)
+        return elm_genlist_item_append(p_list_sys->p_list, itc, p_data, NULL,
+                ELM_GENLIST_ITEM_NONE, pf_selected, p_data);
+    return elm_genlist_item_insert_before(p_list_sys->p_list, itc, p_data, NULL, p_before,
+            ELM_GENLIST_ITEM_NONE, pf_selected, p_data);
+}
+
+/*
+ * Deletes a single genlist item (its del callback takes care of the view item)
+ * and shows the placeholder if it was the last one.
+ */
+void
+list_view_remove_object_item(list_sys* p_list_sys, Elm_Object_Item* p_object_item)
+{
+    if (p_object_item == NULL)
+        return;
+    elm_object_item_del(p_object_item);
+    if (elm_genlist_items_count(p_list_sys->p_list) == 0)
+        list_view_toggle_empty(p_list_sys, true);
+}
+
+/*
+ * The naviframe hides the lists a drill-down view is pushed on top of
+ */
+static void
+list_view_visibility_cb(void *data, Evas *e, Evas_Object *obj, void *event_info)
+{
+    list_sys* p_list_sys = data;
+    if (p_list_sys->p_ctrl != NULL)
+        media_library_controller_set_visible(p_list_sys->p_ctrl, evas_object_visible_get(obj));
+}
+
+/*
+ * Needs to be called before p_list_sys is released, as the widget may
+ * outlive it.
+ */
+void
+list_view_common_release(list_sys* p_list_sys)
+{
+    evas_object_event_callback_del_full(p_list_sys->p_container, EVAS_CALLBACK_SHOW, list_view_visibility_cb, p_list_sys);
+    evas_object_event_callback_del_full(p_list_sys->p_container, EVAS_CALLBACK_HIDE, list_view_visibility_cb, p_list_sys);
+}
+
 void
 list_view_common_setup(list_view* p_list_view, list_sys* p_list_sys, interface* p_intf, Evas_Object* p_parent, list_view_create_option opts )
 {
     p_list_sys->p_intf = p_intf;
     p_list_sys->p_parent = p_parent;
+    p_list_sys->p_view = p_list_view;
 
     /* Create layout and set the theme */
     Evas_Object *layout = elm_layout_add(p_parent);
@@ -125,9 +218,14 @@ list_view_common_setup(list_view* p_list_view, list_sys* p_list_sys, interface*
     /* Setup common callbacks */
     p_list_view->pf_del = &list_view_destroy;
     p_list_view->pf_clear = &list_view_clear;
+    p_list_view->pf_append_item = &list_view_append_item;
+    p_list_view->pf_insert_items = &list_view_insert_items;
     p_list_view->pf_get_widget = &list_view_get_widget;
     p_list_view->pf_get_list = &list_view_get_list;
 
+    evas_object_event_callback_add(layout, EVAS_CALLBACK_SHOW, list_view_visibility_cb, p_list_sys);
+    evas_object_event_callback_add(layout, EVAS_CALLBACK_HIDE, list_view_visibility_cb, p_list_sys);
+
     /* Ensure the initial update takes place (keep in mind that b_empty is 0 initialized) */
     list_view_toggle_empty(p_list_sys, true);
 
@@ -39,12 +39,24 @@
     Evas_Object*                p_container;            \
     Evas_Object*                p_box;                  \
     Evas_Object*                p_empty_label;          \
-    bool                        b_empty;
+    list_view*                  p_view;                 \
+    bool                        b_empty;                \
+    bool                        b_in_batch;             \
+    bool                        b_batch_empty;
 
 void
 list_view_common_setup(list_view* p_view, list_sys* p_list, interface* p_intf, Evas_Object* p_parent, list_view_create_option opts);
 
+void
+list_view_common_release(list_sys* p_list);
+
 void
 list_view_toggle_empty(list_sys* p_view, bool b_empty);
 
+void
+list_view_remove_object_item(list_sys* p_view, Elm_Object_Item* p_object_item);
+
+Elm_Object_Item*
+list_view_insert_object_item(list_sys* p_view, const Elm_Genlist_Item_Class* itc, void* p_data, Evas_Smart_Cb pf_selected, Elm_Object_Item* p_before);
+
 #endif // LIST_VIEW_PRIVATE_H_
@@ -50,6 +50,8 @@ menu_performance_selected_cb(settings_menu_selected *selected, view_sys* p_view_
 void
 menu_deblocking_selected_cb(settings_menu_selected *selected, view_sys* p_view_sys, void *data, Evas_Object *parent);
 void
+menu_crossfade_selected_cb(settings_menu_selected *selected, view_sys* p_view_sys, void *data, Evas_Object *parent);
+void
 menu_developer_selected_cb(settings_menu_selected *selected, view_sys* p_view_sys, void *data, Evas_Object *parent);
 
 struct view_sys {
@@ -68,6 +70,7 @@ settings_item settings_menu[] =
         {0,                             "Extra settings",               NULL,                               SETTINGS_TYPE_CATEGORY},
         {SETTINGS_ID_PERFORMANCES,      "Performances",                 "ic_menu_preferences.png",          SETTINGS_TYPE_ITEM,         menu_performance_selected_cb},
         {SETTINGS_ID_DEBLOCKING,        "Deblocking filter settings",   "ic_menu_preferences.png",          SETTINGS_TYPE_ITEM,         menu_deblocking_selected_cb},
+        {SETTINGS_ID_CROSSFADE,         "Audio crossfade",              "ic_menu_preferences.png",          SETTINGS_TYPE_ITEM,         menu_crossfade_selected_cb},
         {SETTINGS_ID_DEVELOPER,         "Developer",                    "ic_menu_preferences.png",          SETTINGS_TYPE_ITEM,         menu_developer_selected_cb}
 };
 
@@ -161,6 +164,19 @@ settings_item deblocking_filter_settings_menu[] =
 
 };
 
+/* The index of each entry, times 2, is the crossfade duration in seconds */
+settings_item crossfade_menu[] =
+{
+        {CROSSFADE_DISABLED, "Disabled",    NULL, SETTINGS_TYPE_TOGGLE},
+        {CROSSFADE_2S, "2 seconds",         NULL, SETTINGS_TYPE_TOGGLE},
+        {CROSSFADE_4S, "4 seconds",         NULL, SETTINGS_TYPE_TOGGLE},
+        {CROSSFADE_6S, "6 seconds",         NULL, SETTINGS_TYPE_TOGGLE},
+        {CROSSFADE_8S, "8 seconds",         NULL, SETTINGS_TYPE_TOGGLE},
+        {CROSSFADE_10S, "10 seconds",       NULL, SETTINGS_TYPE_TOGGLE},
+        {CROSSFADE_12S, "12 seconds",       NULL, SETTINGS_TYPE_TOGGLE}
+
+};
+
 settings_item developer_menu[] =
 {
         {DEVELOPER_VERBOSE, "Verbose", NULL, SETTINGS_TYPE_TOGGLE}
@@ -238,6 +254,16 @@ settings_view_simple_save_toggle(settings_menu_selected *selected, view_sys* p_v
         preferences_set_enum(PREF_DEBLOCKING, selected->menu[selected->index].id);
         settings_popup_close(p_view_sys->popup);
         break;
+    case SETTINGS_ID_CROSSFADE:
+    {
+        settings_toggle_set_one_by_index(selected->menu, selected->menu_len, selected->index, true, true);
+        preferences_set_index(PREF_CROSSFADE, selected->index * 2);
+        // No need to restart emotion for this one
+        application *p_app = intf_get_application(p_view_sys->p_intf);
+        playback_service_set_crossfade(application_get_playback_service(p_app), selected->index * 2);
+        settings_popup_close(p_view_sys->popup);
+        break;
+    }
     case SETTINGS_ID_DEVELOPER:
     {
         bool newvalue = !selected->menu[selected->index].toggled;
@@ -357,6 +383,23 @@ menu_deblocking_selected_cb(settings_menu_selected *selected, view_sys* p_view_s
     evas_object_event_callback_add(p_view_sys->popup, EVAS_CALLBACK_FREE, settings_view_popup_clear_cb, p_view_sys);
 }
 
+void
+menu_crossfade_selected_cb(settings_menu_selected *selected, view_sys* p_view_sys, void *data, Evas_Object *parent)
+{
+    settings_menu_context *ctx = malloc(sizeof(*ctx));
+    ctx->menu_id = SETTINGS_ID_CROSSFADE;
+
+    int len = COUNT_OF(crossfade_menu);
+    int index = preferences_get_index(PREF_CROSSFADE, 0) / 2;
+    if (index < 0 || index >= len)
+        index = 0;
+    p_view_sys->popup = settings_popup_add(crossfade_menu, len, settings_view_simple_save_toggle, ctx, p_view_sys, parent);
+    settings_toggle_set_one_by_index(crossfade_menu, len, index, true, true);
+    evas_object_show(p_view_sys->popup);
+    evas_object_event_callback_add(p_view_sys->popup, EVAS_CALLBACK_FREE, settings_view_delete_context_cb, ctx);
+    evas_object_event_callback_add(p_view_sys->popup, EVAS_CALLBACK_FREE, settings_view_popup_clear_cb, p_view_sys);
+}
+
 void
 menu_developer_selected_cb(settings_menu_selected *selected, view_sys* p_view_sys, void *data, Evas_Object *parent)
 {
@@ -392,7 +435,7 @@ settings_view_last_view_pop(void *data, Elm_Object_Item *it)
     application *p_app = intf_get_application(p_view_sys->p_intf);
     playback_service *p_ps = application_get_playback_service(p_app);
 
-    playback_service_restart_emotion(p_ps, false);
+    playback_service_apply_options(p_ps);
     return EINA_TRUE;
 }
 
@@ -108,8 +108,9 @@ static void
 video_list_item_set_media_item(list_view_item* p_view_item, void* p_data)
 {
     media_item* p_media_item = (media_item*)p_data;
+    media_item_destroy(p_view_item->p_media_item);
     p_view_item->p_media_item = p_media_item;
-    ecore_main_loop_thread_safe_call_async((Ecore_Cb)elm_genlist_item_update, p_view_item->p_object_item);
+    elm_genlist_item_update(p_view_item->p_object_item);
 }
 
 static Evas_Object*
@@ -166,7 +167,7 @@ genlist_contracted_cb(void *data EINA_UNUSED, Evas_Object *obj EINA_UNUSED, void
 }
 
 static list_view_item*
-video_view_append_item(list_sys *p_list_sys, void* p_data)
+video_view_insert_item(list_sys *p_list_sys, void* p_data, list_view_item* p_before)
 {
     media_item* p_item = (media_item*)p_data;
     /* */
@@ -178,14 +179,9 @@ video_view_append_item(list_sys *p_list_sys, void* p_data)
 
     /* Item instantiation */
     vli->p_media_item = p_item;
-    /* Set and append new item in the genlist */
-    vli->p_object_item = elm_genlist_item_append(p_list_sys->p_list,
-            vli->itc,                       /* genlist item class               */
-            vli,                            /* genlist item class user data     */
-            NULL,                           /* genlist parent item for trees    */
-            ELM_GENLIST_ITEM_NONE,          /* genlist item type                */
-            genlist_item_selected_cb,       /* genlist select smart callback    */
-            vli);                           /* genlist smart callback user data */
+    /* Set and insert new item in the genlist */
+    vli->p_object_item = list_view_insert_object_item(p_list_sys, vli->itc, vli,
+            genlist_item_selected_cb, p_before != NULL ? p_before->p_object_item : NULL);
     if (vli->p_object_item == NULL)
     {
         free(vli);
@@ -197,6 +193,12 @@ video_view_append_item(list_sys *p_list_sys, void* p_data)
     return vli;
 }
 
+static void
+video_view_remove_item(list_sys* p_list_sys, list_view_item* p_view_item)
+{
+    list_view_remove_object_item(p_list_sys, p_view_item->p_object_item);
+}
+
 list_view*
 video_view_list_create(interface *p_intf, Evas_Object *p_parent, list_view_create_option opts)
 {
@@ -224,9 +226,10 @@ video_view_list_create(interface *p_intf, Evas_Object *p_parent, list_view_creat
     evas_object_smart_callback_add(p_list_sys->p_list, "longpressed", genlist_longpressed_cb, NULL);
     evas_object_smart_callback_add(p_list_sys->p_list, "contracted", genlist_contracted_cb, NULL);
 
-    p_list_view->pf_append_item = &video_view_append_item;
+    p_list_view->pf_insert_item = &video_view_insert_item;
     p_list_view->pf_get_item = &video_list_item_get_media_item;
     p_list_view->pf_set_item = &video_list_item_set_media_item;
+    p_list_view->pf_remove_item = &video_view_remove_item;
 
     p_list_sys->p_ctrl = video_controller_create(intf_get_application(p_intf), p_list_view);
     media_library_controller_refresh(p_list_sys->p_ctrl);
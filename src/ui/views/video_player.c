@@ -434,6 +434,7 @@ video_player_start(view_sys *p_sys, const char* file_path, double time)
         .pf_on_new_time = ps_on_new_time_cb,
         .pf_on_stopped = ps_on_stop_cb,
         .pf_on_playpause = ps_on_playpause_cb,
+        .f_time_interval = 0.25,
         .p_user_data = p_sys,
         .i_ctx = PLAYLIST_CONTEXT_VIDEO,
     };